@@ -0,0 +1,65 @@
+/*
+ * ArquivoAtomico.h
+ *
+ * Troca o conteudo de um arquivo de uma vez: grava num temporario ao lado,
+ * manda o temporario para o disco (fsync, _commit no Windows) e o renomeia
+ * por cima do arquivo. O rename do POSIX troca o destino atomicamente e no
+ * Windows o MoveFileEx com MOVEFILE_REPLACE_EXISTING faz o mesmo, entao quem
+ * abrir o arquivo ve o conteudo antigo ou o novo inteiro, mesmo se o processo
+ * morrer ou a maquina reiniciar no meio.
+ */
+
+#ifndef ARQUIVOATOMICO_H_
+#define ARQUIVOATOMICO_H_
+#include <string>
+#include <cstdio>
+
+#ifdef _WIN32
+// Sem o winsock.h (o coordenador usa o winsock2.h) e sem as macros min e max
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+inline bool gravaArquivoAtomico(const std::string& arquivo, const std::string& conteudo)
+{
+	std::string temporario = arquivo + ".tmp";
+	FILE* saida = std::fopen(temporario.c_str(), "wb");
+	if (!saida) return false;
+	bool gravou = std::fwrite(conteudo.data(), 1, conteudo.size(), saida) == conteudo.size() &&
+	              std::fflush(saida) == 0;
+#ifdef _WIN32
+	gravou = gravou && _commit(_fileno(saida)) == 0;
+#else
+	gravou = gravou && fsync(fileno(saida)) == 0;
+#endif
+	gravou = std::fclose(saida) == 0 && gravou;
+	if (!gravou) {
+		std::remove(temporario.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	return MoveFileExA(temporario.c_str(), arquivo.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (std::rename(temporario.c_str(), arquivo.c_str()) != 0) return false;
+	// O rename so fica no disco com a pasta sincronizada
+	size_t barra = arquivo.rfind('/');
+	std::string pasta = barra == std::string::npos ? "." : barra == 0 ? "/" : arquivo.substr(0, barra);
+	int dir = open(pasta.c_str(), O_RDONLY);
+	if (dir >= 0) {
+		fsync(dir);
+		close(dir);
+	}
+	return true;
+#endif
+}
+
+#endif /* ARQUIVOATOMICO_H_ */
@@ -0,0 +1,209 @@
+/*
+ * BibliotecaRodas.h
+ *
+ * Biblioteca persistente das melhores rodas conhecidas, por (R, T, M) e
+ * sobreposicao (S: 0 = busca sem sobreposicao, 1 = permitida). Uma roda so
+ * depende disso: os jogos saem dela trocando as dezenas 1..R pelas dezenas
+ * sorteadas para o fechamento, entao a busca e feita uma vez e cada
+ * fechamento e so um reetiquetamento (reetiquetaRoda).
+ *
+ * Arquivo texto, uma roda por bloco:
+ *
+ *   roda R T M S QTD
+ *   <QTD linhas com as T dezenas (de 1 a R) de cada ticket, separadas por espaco>
+ *
+ * O cabecalho antigo, "roda R T M QTD", e lido como S = 1. Blocos invalidos
+ * (dezenas fora de 1..R, repetidas ou em quantidade errada) e rodas que nao
+ * garantem M sao ignorados na leitura. A gravacao troca o arquivo de uma vez
+ * (ArquivoAtomico.h). confereRoda() verifica uma roda contra todos os
+ * sorteios e completaRoda() acrescenta os que ela deixa descobertos.
+ */
+
+#ifndef BIBLIOTECARODAS_H_
+#define BIBLIOTECARODAS_H_
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include "MascaraDezenas.h"
+#include "IndiceHamming.h"
+#include "ArquivoAtomico.h"
+
+inline uint64_t confereRoda(const std::vector<std::vector<int> >& roda, size_t r, size_t t, size_t m);
+
+class BibliotecaRodas {
+public:
+	typedef std::vector<std::vector<int> > Roda;
+
+	explicit BibliotecaRodas(const std::string& arquivo) : arquivo(arquivo) {}
+
+	const std::string& nomeArquivo() const { return arquivo; }
+
+	// Le o arquivo; devolve false se ele nao existe
+	bool carrega() {
+		std::ifstream entrada(arquivo.c_str());
+		if (!entrada) return false;
+		std::string linha;
+		while (std::getline(entrada, linha)) {
+			std::istringstream cabecalho(linha);
+			std::string marca;
+			size_t r = 0, t = 0, m = 0, sobreposicao = 1, qtd = 0, ultimo = 0;
+			if (!(cabecalho >> marca >> r >> t >> m >> qtd) || marca != "roda") continue;
+			if (cabecalho >> ultimo) {
+				sobreposicao = qtd;
+				qtd = ultimo;
+			}
+
+			Roda roda(qtd);
+			bool valida = r > 0 && t > 0 && t <= r && m <= t;
+			for (size_t i = 0; i < qtd && std::getline(entrada, linha); ++i) {
+				std::istringstream dezenas(linha);
+				int d;
+				while (dezenas >> d) roda[i].push_back(d);
+				valida = valida && ticketValido(roda[i], r, t);
+			}
+			if (valida && confereRoda(roda, r, t, m) == 0) oferece(r, t, m, sobreposicao, roda);
+		}
+		return true;
+	}
+
+	// Melhor roda guardada para (r, t, m, sobreposicao), ou NULL
+	const Roda* busca(size_t r, size_t t, size_t m, size_t sobreposicao) const {
+		std::map<Chave, Roda>::const_iterator achou = rodas.find(chave(r, t, m, sobreposicao));
+		return achou == rodas.end() ? NULL : &achou->second;
+	}
+
+	// Guarda a roda se ela for menor que a conhecida; devolve true se guardou
+	bool oferece(size_t r, size_t t, size_t m, size_t sobreposicao, const Roda& roda) {
+		if (roda.empty()) return false;
+		Roda& atual = rodas[chave(r, t, m, sobreposicao)];
+		if (!atual.empty() && atual.size() <= roda.size()) return false;
+		atual = roda;
+		return true;
+	}
+
+	bool grava() const {
+		std::ostringstream saida;
+		for (std::map<Chave, Roda>::const_iterator it = rodas.begin(); it != rodas.end(); ++it) {
+			const Roda& roda = it->second;
+			saida << "roda " << it->first.first.first << " " << it->first.first.second << " "
+			      << it->first.second.first << " " << it->first.second.second << " " << roda.size() << "\n";
+			for (size_t i = 0; i < roda.size(); ++i) {
+				for (size_t k = 0; k < roda[i].size(); ++k) saida << (k ? " " : "") << roda[i][k];
+				saida << "\n";
+			}
+		}
+		return gravaArquivoAtomico(arquivo, saida.str());
+	}
+
+private:
+	typedef std::pair<size_t, size_t> Par;
+	typedef std::pair<Par, Par> Chave;   ///< ((r, t), (m, sobreposicao))
+
+	std::string arquivo;
+	std::map<Chave, Roda> rodas;
+
+	// O guloso so distingue sobreposicao 0 de qualquer outro valor
+	static Chave chave(size_t r, size_t t, size_t m, size_t sobreposicao) {
+		return Chave(Par(r, t), Par(m, sobreposicao ? 1 : 0));
+	}
+
+	static bool ticketValido(std::vector<int> ticket, size_t r, size_t t) {
+		if (ticket.size() != t) return false;
+		std::sort(ticket.begin(), ticket.end());
+		for (size_t k = 0; k < t; ++k)
+			if (ticket[k] < 1 || ticket[k] > static_cast<int>(r) || (k && ticket[k] == ticket[k - 1])) return false;
+		return true;
+	}
+};
+
+/**
+ * Jogos da roda no fechamento 'dezenas' (R dezenas, dezenas[i - 1] no lugar
+ * da dezena i da roda), acrescentados a 'jogos'.
+ **/
+inline void reetiquetaRoda(const BibliotecaRodas::Roda& roda, const std::vector<int>& dezenas,
+                           std::vector<std::vector<int> >& jogos)
+{
+	size_t inicio = jogos.size();
+	jogos.resize(inicio + roda.size());
+	for (size_t i = 0; i < roda.size(); ++i) {
+		std::vector<int>& jogo = jogos[inicio + i];
+		jogo.resize(roda[i].size());
+		for (size_t k = 0; k < roda[i].size(); ++k) jogo[k] = dezenas[roda[i][k] - 1];
+	}
+}
+
+// Liga o despacho de despachaMascara() a confereRoda
+struct ConfereRoda
+{
+	const BibliotecaRodas::Roda& roda;
+	size_t r, t, m;
+	uint64_t descobertos;
+	BibliotecaRodas::Roda* faltam;   ///< se nao NULL, recebe os descobertos, que dai em diante contam na roda
+
+	template <class M>
+	void executa()
+	{
+		// Cobrir e estar a no maximo 2 (t - m) da mascara de um ticket da roda
+		size_t raio = 2 * (t - m);
+		IndiceHamming<M> indice(r + 1, raio + 1);
+		for (size_t i = 0; i < roda.size(); ++i) indice.insere(mascaraDeDezenas<M>(roda[i]));
+
+		// Todos os t-subconjuntos de 1..r, em ordem lexicografica
+		std::vector<int> sorteio(t);
+		for (size_t i = 0; i < t; ++i) sorteio[i] = static_cast<int>(i + 1);
+		descobertos = 0;
+		while (true) {
+			bool coberto = false;
+			indice.vizinhos(mascaraDeDezenas<M>(sorteio), raio, [&](uint32_t, unsigned) { coberto = true; });
+			if (!coberto) {
+				++descobertos;
+				if (faltam) {
+					faltam->push_back(sorteio);
+					indice.insere(mascaraDeDezenas<M>(sorteio));
+				}
+			}
+
+			size_t i = t;
+			while (i > 0 && sorteio[i - 1] == static_cast<int>(r - t + i)) --i;
+			if (i == 0) break;
+			++sorteio[i - 1];
+			for (size_t j = i; j < t; ++j) sorteio[j] = sorteio[j - 1] + 1;
+		}
+	}
+};
+
+/**
+ * Quantos sorteios de t dezenas entre 1..r nao acertam m dezenas de nenhum
+ * ticket da roda (0 = a roda garante m). UINT64_MAX se r passa das mascaras.
+ * Cada sorteio e uma consulta de raio no IndiceHamming dos tickets da roda,
+ * no lugar de comparar com todos eles.
+ **/
+inline uint64_t confereRoda(const BibliotecaRodas::Roda& roda, size_t r, size_t t, size_t m)
+{
+	ConfereRoda confere = { roda, r, t, m, UINT64_MAX, NULL };
+	if (t > r || m > t) return UINT64_MAX;
+	if (!despachaMascara(r + 1, confere)) return UINT64_MAX;
+	return confere.descobertos;
+}
+
+/**
+ * Acrescenta em 'faltam' os sorteios que a roda deixa descobertos, cada um
+ * como ticket (ele cobre a si mesmo e os vizinhos, que nao entram mais). Com
+ * eles a roda garante m: o guloso as vezes para com um ou dois sorteios
+ * descobertos. Devolve quantos entraram, ou UINT64_MAX como confereRoda.
+ **/
+inline uint64_t completaRoda(const BibliotecaRodas::Roda& roda, size_t r, size_t t, size_t m,
+                             BibliotecaRodas::Roda& faltam)
+{
+	ConfereRoda confere = { roda, r, t, m, UINT64_MAX, &faltam };
+	if (t > r || m > t) return UINT64_MAX;
+	if (!despachaMascara(r + 1, confere)) return UINT64_MAX;
+	return confere.descobertos;
+}
+
+#endif /* BIBLIOTECARODAS_H_ */
@@ -0,0 +1,115 @@
+/*
+ * Binomial.h
+ *
+ * Coeficientes binomiais C(n, k) para n <= 64 em uma tabela do triangulo de
+ * Pascal montada em tempo de compilacao. C(64, 32) ~ 1.8e18 ainda cabe em
+ * 64 bits, entao a tabela inteira e exata; fora dela (n > 64), ou em produtos
+ * e somas de binomiais, o resultado satura em UINT64_MAX em vez de dar a
+ * volta, para que verificacoes de limite como "tickets demais" continuem
+ * falhando do lado seguro.
+ *
+ * So usa o constexpr do C++11 (uma expressao por funcao), entao a tabela e
+ * gerada a partir de sequencias de indices em vez de lacos.
+ */
+
+#ifndef BINOMIAL_H_
+#define BINOMIAL_H_
+#include <stdint.h>
+#include <stddef.h>
+
+#define BINOMIAL_MAX_N 64
+
+// Multiplicacao e soma que saturam em UINT64_MAX
+inline uint64_t multiplicaSatura(uint64_t a, uint64_t b)
+{
+	return (a != 0 && b > UINT64_MAX / a) ? UINT64_MAX : a * b;
+}
+
+inline uint64_t somaSatura(uint64_t a, uint64_t b)
+{
+	return (b > UINT64_MAX - a) ? UINT64_MAX : a + b;
+}
+
+namespace binomial_detalhe {
+
+constexpr uint64_t mdc(uint64_t a, uint64_t b)
+{
+	return b == 0 ? a : mdc(b, a % b);
+}
+
+// C(n, i) a partir de C(n, i - 1): c * (n - i + 1) / i, dividindo antes pelo
+// mdc para nunca passar do proprio resultado
+constexpr uint64_t passo(uint64_t c, uint64_t n, uint64_t i, uint64_t g)
+{
+	return (c / g) * ((n - i + 1) / (i / g));
+}
+
+constexpr uint64_t ate(uint64_t n, uint64_t k, uint64_t i, uint64_t c)
+{
+	return i > k ? c : ate(n, k, i + 1, passo(c, n, i, mdc(c, i)));
+}
+
+constexpr uint64_t calcula(uint64_t n, uint64_t k)
+{
+	return k > n ? 0 : ate(n, (k > n - k ? n - k : k), 1, 1);
+}
+
+template <size_t... I> struct Indices {};
+template <size_t N, size_t... I> struct GeraIndices : GeraIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct GeraIndices<0, I...> { typedef Indices<I...> tipo; };
+
+struct Linha { uint64_t k[BINOMIAL_MAX_N + 1]; };
+struct Tabela { Linha n[BINOMIAL_MAX_N + 1]; };
+
+template <size_t N, size_t... K>
+constexpr Linha linha(Indices<K...>)
+{
+	return Linha{{ calcula(N, K)... }};
+}
+
+template <size_t... N>
+constexpr Tabela tabela(Indices<N...>)
+{
+	return Tabela{{ linha<N>(typename GeraIndices<BINOMIAL_MAX_N + 1>::tipo())... }};
+}
+
+// Membro estatico de um template para poder ficar no header sem violar a ODR
+template <class Nada = void>
+struct Pascal {
+	static constexpr Tabela valores = tabela(typename GeraIndices<BINOMIAL_MAX_N + 1>::tipo());
+};
+
+template <class Nada>
+constexpr Tabela Pascal<Nada>::valores;
+
+} // namespace binomial_detalhe
+
+/**
+ * C(n, k) em tempo de compilacao; n acima de BINOMIAL_MAX_N nao compila
+ * (o indice sai da tabela numa expressao constante).
+ **/
+constexpr uint64_t binomialConst(size_t n, size_t k)
+{
+	return k > n ? 0 : binomial_detalhe::Pascal<>::valores.n[n].k[k];
+}
+
+/**
+ * C(n, k) em tempo de execucao: consulta a tabela para n <= 64 e, acima
+ * disso, calcula saturando em UINT64_MAX.
+ **/
+inline uint64_t binomial(size_t n, size_t k)
+{
+	if (k > n) return 0;
+	if (n <= BINOMIAL_MAX_N) return binomial_detalhe::Pascal<>::valores.n[n].k[k];
+
+	if (k > n - k) k = n - k;
+	uint64_t c = 1;
+	for (uint64_t i = 1; i <= k; ++i) {
+		uint64_t g = binomial_detalhe::mdc(c, i);
+		c = multiplicaSatura(c / g, (n - i + 1) / (i / g));
+		if (c == UINT64_MAX) return UINT64_MAX;
+	}
+	return c;
+}
+
+#endif /* BINOMIAL_H_ */
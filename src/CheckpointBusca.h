@@ -0,0 +1,138 @@
+/*
+ * CheckpointBusca.h
+ *
+ * Checkpoint das buscas longas (--checkpoint ARQ, retomado com --retoma):
+ * a melhor roda ate agora (ranks dos tickets), a semente e quantas sementes
+ * ja sairam de novaSemente() (com --semente isso e o estado inteiro dos
+ * geradores) e quantas tentativas ja foram feitas. O grafo nao entra: ele
+ * sai de (r, t, m) e e remontado igual na retomada.
+ *
+ * O checkpoint e tirado entre uma tentativa e outra. GravadorCheckpoint
+ * grava numa thread propria: a busca so copia o estado (do tamanho da
+ * roda) e segue; se a gravacao anterior ainda nao acabou, o estado novo
+ * substitui o pendente. Cada gravacao passa por gravaArquivoAtomico
+ * (ArquivoAtomico.h), entao o arquivo sempre tem um checkpoint inteiro.
+ *
+ *   checkpoint 1
+ *   configuracao R T M SOBREPOSICAO
+ *   semente SEMENTE USADAS
+ *   tentativas FEITAS
+ *   roda QTD
+ *   <QTD linhas com o rank de cada ticket>
+ */
+
+#ifndef CHECKPOINTBUSCA_H_
+#define CHECKPOINTBUSCA_H_
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <stddef.h>
+#include "ArquivoAtomico.h"
+
+struct EstadoBusca
+{
+	size_t r, t, m, sobreposicao;
+	uint64_t semente, sementes_usadas;
+	size_t tentativas_feitas;
+	std::vector<uint64_t> roda;   ///< ranks de generateAllCombos; vazia = nenhuma roda completa ainda
+
+	EstadoBusca() : r(0), t(0), m(0), sobreposicao(0), semente(0), sementes_usadas(0), tentativas_feitas(0) {}
+
+	bool mesmaConfiguracao(size_t r_, size_t t_, size_t m_, size_t sobreposicao_) const {
+		return r == r_ && t == t_ && m == m_ && sobreposicao == sobreposicao_;
+	}
+};
+
+inline bool gravaEstadoBusca(const std::string& arquivo, const EstadoBusca& estado)
+{
+	std::ostringstream saida;
+	saida << "checkpoint 1\n"
+	      << "configuracao " << estado.r << " " << estado.t << " " << estado.m << " " << estado.sobreposicao << "\n"
+	      << "semente " << estado.semente << " " << estado.sementes_usadas << "\n"
+	      << "tentativas " << estado.tentativas_feitas << "\n"
+	      << "roda " << estado.roda.size() << "\n";
+	for (size_t i = 0; i < estado.roda.size(); ++i) saida << estado.roda[i] << "\n";
+	return gravaArquivoAtomico(arquivo, saida.str());
+}
+
+// Devolve false se o arquivo nao existe ou nao e um checkpoint inteiro
+inline bool carregaEstadoBusca(const std::string& arquivo, EstadoBusca& estado)
+{
+	std::ifstream entrada(arquivo.c_str());
+	std::string marca, configuracao, semente, tentativas, roda;
+	int versao = 0;
+	size_t qtd = 0;
+	EstadoBusca lido;
+	if (!(entrada >> marca >> versao) || marca != "checkpoint" || versao != 1) return false;
+	if (!(entrada >> configuracao >> lido.r >> lido.t >> lido.m >> lido.sobreposicao) || configuracao != "configuracao") return false;
+	if (!(entrada >> semente >> lido.semente >> lido.sementes_usadas) || semente != "semente") return false;
+	if (!(entrada >> tentativas >> lido.tentativas_feitas) || tentativas != "tentativas") return false;
+	if (!(entrada >> roda >> qtd) || roda != "roda") return false;
+	lido.roda.resize(qtd);
+	for (size_t i = 0; i < qtd; ++i)
+		if (!(entrada >> lido.roda[i])) return false;
+	estado = lido;
+	return true;
+}
+
+class GravadorCheckpoint {
+public:
+	explicit GravadorCheckpoint(const std::string& arquivo)
+		: arquivo(arquivo), tem_pendente(false), encerrando(false), falhas(0),
+		  escritor(&GravadorCheckpoint::trabalha, this) {}
+
+	// Grava o que estiver pendente e para a thread
+	~GravadorCheckpoint() {
+		{
+			std::lock_guard<std::mutex> trava(mtx);
+			encerrando = true;
+		}
+		cv.notify_one();
+		escritor.join();
+	}
+
+	// Entrega o estado para gravar; nao espera a gravacao
+	void oferece(const EstadoBusca& estado) {
+		std::lock_guard<std::mutex> trava(mtx);
+		pendente = estado;
+		tem_pendente = true;
+		cv.notify_one();
+	}
+
+	size_t qtdFalhas() {
+		std::lock_guard<std::mutex> trava(mtx);
+		return falhas;
+	}
+
+private:
+	std::string arquivo;
+	std::mutex mtx;
+	std::condition_variable cv;
+	EstadoBusca pendente;
+	bool tem_pendente, encerrando;
+	size_t falhas;
+	std::thread escritor;   ///< por ultimo: so comeca depois dos outros membros
+
+	void trabalha() {
+		while (true) {
+			EstadoBusca estado;
+			{
+				std::unique_lock<std::mutex> trava(mtx);
+				cv.wait(trava, [&]() { return tem_pendente || encerrando; });
+				if (!tem_pendente) return;
+				std::swap(estado, pendente);
+				tem_pendente = false;
+			}
+			bool gravou = gravaEstadoBusca(arquivo, estado);
+			std::lock_guard<std::mutex> trava(mtx);
+			if (!gravou) ++falhas;
+		}
+	}
+};
+
+#endif /* CHECKPOINTBUSCA_H_ */
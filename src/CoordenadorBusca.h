@@ -0,0 +1,278 @@
+/*
+ * CoordenadorBusca.h
+ *
+ * Busca espalhada por varios processos, na mesma maquina ou em outras
+ * (--coordenador PORTA e --trabalhador HOST:PORTA). O coordenador tem a lista
+ * de trabalhos e reparte as tentativas de cada um em blocos; os trabalhadores
+ * montam o grafo uma vez, rodam os blocos que recebem e mandam de volta cada
+ * roda menor que acharem. A menor roda conhecida vai para todos os
+ * trabalhadores, que passam a abandonar as tentativas que ja a passaram.
+ *
+ * O canal e TCP (winsock no Windows), uma linha de texto por mensagem:
+ *
+ *   trabalhador -> coordenador
+ *     trabalhador                      ao conectar
+ *     roda ID QTD RANK...              roda completa (completaRoda) menor que a
+ *                                      ultima 'menor' recebida
+ *     feito ID TENTATIVAS              fim do bloco
+ *   coordenador -> trabalhador
+ *     bloco ID R T M SOBREPOSICAO SEMENTE PRIMEIRA TENTATIVAS MENOR
+ *     menor R T M QTD                  nova menor roda do trabalho
+ *     para                             fecha o bloco agora (prazo ou sinal)
+ *     fim
+ *
+ * Os ranks sao os de generateAllCombos, como no checkpoint. O bloco K de um
+ * trabalho usa as sementes de novaSemente() a partir de K * SEMENTES_POR_BLOCO
+ * (defineSemente(SEMENTE, PRIMEIRA)), entao os blocos nunca repetem sementes.
+ * Com um bloco por tentativa (--bloco 1, o padrao) e --simetria 0 cada
+ * tentativa so depende das suas sementes, e a melhor roda sai do mesmo
+ * tamanho com qualquer quantidade de trabalhadores; com a simetria ligada o
+ * desempate depende das tentativas que o processo ja fez.
+ *
+ * Os trabalhadores nao se identificam: o coordenador confere cada roda que
+ * chega (confereRoda) antes de aceita-la e difundir a 'menor', e com a porta
+ * 0 (so --trabalhadores-locais) escuta apenas em 127.0.0.1.
+ */
+
+#ifndef COORDENADORBUSCA_H_
+#define COORDENADORBUSCA_H_
+#include <vector>
+#include <string>
+#include <sstream>
+#include <memory>
+#include <mutex>
+#include <cstdlib>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+class CanalTcp {
+public:
+#ifdef _WIN32
+	typedef SOCKET Nativo;
+#else
+	typedef int Nativo;
+#endif
+
+	CanalTcp() : s(invalido()) {}
+	~CanalTcp() { fecha(); }
+	CanalTcp(const CanalTcp&) = delete;
+	CanalTcp& operator=(const CanalTcp&) = delete;
+
+	// WSAStartup no Windows, uma vez por processo
+	static bool iniciaRede() {
+#ifdef _WIN32
+		static std::mutex trava;
+		static bool iniciada = false;
+		std::lock_guard<std::mutex> guarda(trava);
+		if (!iniciada) {
+			WSADATA dados;
+			iniciada = WSAStartup(MAKEWORD(2, 2), &dados) == 0;
+		}
+		return iniciada;
+#else
+		return true;
+#endif
+	}
+
+	bool conecta(const std::string& host, unsigned porta) {
+		fecha();
+		if (!iniciaRede()) return false;
+		addrinfo dicas = addrinfo();
+		dicas.ai_family = AF_UNSPEC;
+		dicas.ai_socktype = SOCK_STREAM;
+		addrinfo* enderecos = NULL;
+		if (getaddrinfo(host.c_str(), std::to_string(porta).c_str(), &dicas, &enderecos) != 0) return false;
+		for (addrinfo* a = enderecos; a && s == invalido(); a = a->ai_next) {
+			s = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+			if (s != invalido() && ::connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) != 0) fecha();
+		}
+		freeaddrinfo(enderecos);
+		if (s == invalido()) return false;
+		semAtraso();
+		return true;
+	}
+
+	// Escuta em todas as interfaces, ou so em 127.0.0.1 com 'so_local'; porta 0
+	// pega uma livre, devolvida em 'porta'
+	bool escuta(unsigned& porta, bool so_local = false) {
+		fecha();
+		if (!iniciaRede()) return false;
+		s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (s == invalido()) return false;
+		int um = 1;
+		::setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&um), sizeof(um));
+		sockaddr_in endereco = sockaddr_in();
+		endereco.sin_family = AF_INET;
+		endereco.sin_addr.s_addr = htonl(so_local ? INADDR_LOOPBACK : INADDR_ANY);
+		endereco.sin_port = htons(static_cast<unsigned short>(porta));
+		if (::bind(s, reinterpret_cast<sockaddr*>(&endereco), sizeof(endereco)) != 0 || ::listen(s, 16) != 0) {
+			fecha();
+			return false;
+		}
+		socklen_t tamanho = sizeof(endereco);
+		if (::getsockname(s, reinterpret_cast<sockaddr*>(&endereco), &tamanho) == 0) porta = ntohs(endereco.sin_port);
+		return true;
+	}
+
+	// Proxima conexao de quem escuta; vazio se o canal fechou
+	std::unique_ptr<CanalTcp> aceita() {
+		std::unique_ptr<CanalTcp> canal;
+		Nativo novo = ::accept(s, NULL, NULL);
+		if (novo == invalido()) return canal;
+		canal.reset(new CanalTcp);
+		canal->s = novo;
+		canal->semAtraso();
+		return canal;
+	}
+
+	// Manda o texto inteiro; pode ser chamado de varias threads
+	bool envia(const std::string& texto) {
+		std::lock_guard<std::mutex> guarda(trava_envio);
+		for (size_t enviado = 0; enviado < texto.size();) {
+			int n = ::send(s, texto.data() + enviado, static_cast<int>(texto.size() - enviado), SEM_SIGPIPE);
+			if (n <= 0) return false;
+			enviado += n;
+		}
+		return true;
+	}
+
+	// Proxima linha, sem o fim de linha; false quando a conexao acaba. So uma
+	// thread le cada canal
+	bool recebeLinha(std::string& linha) {
+		size_t fim;
+		while ((fim = recebido.find('\n')) == std::string::npos) {
+			char bloco[4096];
+			int n = ::recv(s, bloco, sizeof(bloco), 0);
+			if (n <= 0) return false;
+			recebido.append(bloco, n);
+		}
+		linha.assign(recebido, 0, fim);
+		recebido.erase(0, fim + 1);
+		if (!linha.empty() && linha[linha.size() - 1] == '\r') linha.erase(linha.size() - 1);
+		return true;
+	}
+
+	// Acorda quem estiver lendo este canal em outra thread, sem fechar o descritor
+	void encerra() {
+#ifdef _WIN32
+		if (s != invalido()) ::shutdown(s, SD_BOTH);
+#else
+		if (s != invalido()) ::shutdown(s, SHUT_RDWR);
+#endif
+	}
+
+	void fecha() {
+		if (s == invalido()) return;
+#ifdef _WIN32
+		::closesocket(s);
+#else
+		::close(s);
+#endif
+		s = invalido();
+	}
+
+private:
+#if defined(MSG_NOSIGNAL)
+	enum { SEM_SIGPIPE = MSG_NOSIGNAL };
+#else
+	enum { SEM_SIGPIPE = 0 };
+#endif
+
+	Nativo s;
+	std::string recebido;
+	std::mutex trava_envio;
+
+	static Nativo invalido() {
+#ifdef _WIN32
+		return INVALID_SOCKET;
+#else
+		return -1;
+#endif
+	}
+
+	// As mensagens sao pequenas e esperadas do outro lado: sem Nagle
+	void semAtraso() {
+		int um = 1;
+		::setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&um), sizeof(um));
+	}
+};
+
+// "host:porta" (o host pode faltar: ":porta" e "porta" sao a maquina local)
+inline bool separaEndereco(const std::string& endereco, std::string& host, unsigned& porta)
+{
+	size_t dois_pontos = endereco.rfind(':');
+	host = dois_pontos == std::string::npos ? "" : endereco.substr(0, dois_pontos);
+	if (host.empty()) host = "127.0.0.1";
+	std::string numero = dois_pontos == std::string::npos ? endereco : endereco.substr(dois_pontos + 1);
+	char* fim = NULL;
+	unsigned long valor = strtoul(numero.c_str(), &fim, 10);
+	if (numero.empty() || *fim != '\0' || valor == 0 || valor > 65535) return false;
+	porta = static_cast<unsigned>(valor);
+	return true;
+}
+
+// Distancia entre as primeiras sementes de dois blocos seguidos
+const uint64_t SEMENTES_POR_BLOCO = UINT64_C(1) << 32;
+
+struct BlocoBusca
+{
+	uint64_t id;
+	size_t r, t, m, sobreposicao;
+	uint64_t semente, primeira_semente;   ///< defineSemente(semente, primeira_semente)
+	size_t tentativas;
+	size_t menor;                         ///< menor roda do trabalho quando o bloco saiu
+
+	BlocoBusca() : id(0), r(0), t(0), m(0), sobreposicao(0), semente(0), primeira_semente(0), tentativas(0), menor(0) {}
+
+	bool mesmaRoda(size_t r_, size_t t_, size_t m_) const { return r == r_ && t == t_ && m == m_; }
+
+	std::string linha() const {
+		std::ostringstream texto;
+		texto << "bloco " << id << " " << r << " " << t << " " << m << " " << sobreposicao << " " << semente
+		      << " " << primeira_semente << " " << tentativas << " " << menor << "\n";
+		return texto.str();
+	}
+};
+
+inline bool interpretaBloco(const std::string& linha, BlocoBusca& bloco)
+{
+	std::istringstream campos(linha);
+	std::string marca;
+	return (campos >> marca >> bloco.id >> bloco.r >> bloco.t >> bloco.m >> bloco.sobreposicao >> bloco.semente
+	               >> bloco.primeira_semente >> bloco.tentativas >> bloco.menor) && marca == "bloco";
+}
+
+inline std::string linhaRoda(uint64_t id, const std::vector<uint64_t>& ranks)
+{
+	std::ostringstream texto;
+	texto << "roda " << id << " " << ranks.size();
+	for (size_t i = 0; i < ranks.size(); ++i) texto << " " << ranks[i];
+	texto << "\n";
+	return texto.str();
+}
+
+// Le "roda ID QTD RANK..." (a marca ja conferida por quem chamou); QTD acima
+// de 'maximo' e recusada antes de reservar espaco
+inline bool interpretaRoda(std::istringstream& campos, uint64_t& id, std::vector<uint64_t>& ranks, size_t maximo)
+{
+	size_t qtd = 0;
+	if (!(campos >> id >> qtd) || qtd > maximo) return false;
+	ranks.resize(qtd);
+	for (size_t i = 0; i < qtd; ++i)
+		if (!(campos >> ranks[i])) return false;
+	return true;
+}
+
+#endif /* COORDENADORBUSCA_H_ */
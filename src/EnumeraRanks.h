@@ -0,0 +1,94 @@
+/*
+ * EnumeraRanks.h
+ *
+ * Ranks de combinacoes na ordem de generateAllCombos (lexicografica nos
+ * indices marcados) gerados direto a partir das posicoes, sem montar
+ * dynamic_bitset: e a base do grafo em disco e do motor implicito, que
+ * recalculam as listas de adjacencia em vez de guarda-las.
+ */
+
+#ifndef ENUMERARANKS_H_
+#define ENUMERARANKS_H_
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include "Binomial.h"
+
+/**
+ * Percorre em ordem crescente os ranks dos k-subconjuntos de [0, n) com
+ * exatamente qtd_a posicoes da classe A e as k - qtd_a restantes da classe B
+ * (posicoes FORA nunca entram). O rank de p_0 < ... < p_{k-1} e
+ * C(n, k) - 1 - soma C(n - 1 - p_i, k - i), e a soma vai sendo acumulada na
+ * descida, entao cada subconjunto custa uma soma.
+ *
+ * Exemplos, com n dezenas: as garantias (m-subconjuntos) de um ticket sao as
+ * m posicoes da classe A tiradas do ticket; os tickets de uma garantia sao a
+ * garantia inteira (A) mais t - m das outras dezenas (B); e os tickets com
+ * exatamente j dezenas em comum com um ticket sao j das dele (A) e t - j das
+ * outras (B).
+ **/
+class EnumeraRanks {
+public:
+	enum { FORA = 0, CLASSE_A = 1, CLASSE_B = 2 };
+
+	EnumeraRanks(size_t n, size_t k)
+		: n(n), k(k), estado(n + 1, FORA), restantes_a(n + 1, 0), restantes_b(n + 1, 0),
+		  tabela(n * (k + 1)), total(binomial(n, k)) {
+		for (size_t a = 0; a < n; ++a)
+			for (size_t b = 0; b <= k; ++b)
+				tabela[a * (k + 1) + b] = binomial(a, b);
+	}
+
+	// Classe da posicao p; limpa() volta todas para FORA
+	void marca(size_t p, uint8_t classe) { estado[p] = classe; }
+	void limpa() { std::fill(estado.begin(), estado.end(), FORA); }
+
+	template <class Indice>
+	void enumera(size_t qtd_a, std::vector<Indice>& saida) {
+		for (size_t x = n; x-- > 0;) {
+			restantes_a[x] = restantes_a[x + 1] + (estado[x] == CLASSE_A);
+			restantes_b[x] = restantes_b[x + 1] + (estado[x] == CLASSE_B);
+		}
+		if (qtd_a > k || restantes_a[0] < qtd_a || restantes_b[0] < k - qtd_a) return;
+		anda(0, qtd_a, k - qtd_a, 0, saida);
+	}
+
+	/**
+	 * Inverso do rank para combinacoes de 'tamanho' <= k elementos de [0, n):
+	 * grava as posicoes marcadas, em ordem, em 'posicoes'.
+	 **/
+	void desfazRank(uint64_t rank, size_t tamanho, size_t* posicoes) const {
+		for (size_t x = 0, i = 0; x < n && i < tamanho; ++x) {
+			uint64_t com_x = tabela[(n - 1 - x) * (k + 1) + (tamanho - 1 - i)];
+			if (rank < com_x) posicoes[i++] = x;
+			else rank -= com_x;
+		}
+	}
+
+private:
+	size_t n, k;
+	std::vector<uint8_t> estado;
+	std::vector<size_t> restantes_a, restantes_b;   ///< quantas de cada classe em [x, n)
+	std::vector<uint64_t> tabela;                   ///< tabela[a * (k + 1) + b] = C(a, b)
+	uint64_t total;
+
+	template <class Indice>
+	void anda(size_t x, size_t falta_a, size_t falta_b, uint64_t soma, std::vector<Indice>& saida) {
+		if (falta_a + falta_b == 0) {
+			saida.push_back(static_cast<Indice>(total - 1 - soma));
+			return;
+		}
+		while (estado[x] == FORA) ++x;
+		uint64_t parcela = tabela[(n - 1 - x) * (k + 1) + falta_a + falta_b];
+		if (estado[x] == CLASSE_A) {
+			if (falta_a > 0) anda(x + 1, falta_a - 1, falta_b, soma + parcela, saida);
+			if (restantes_a[x + 1] >= falta_a) anda(x + 1, falta_a, falta_b, soma, saida);
+		} else {
+			if (falta_b > 0) anda(x + 1, falta_a, falta_b - 1, soma + parcela, saida);
+			if (restantes_b[x + 1] >= falta_b) anda(x + 1, falta_a, falta_b, soma, saida);
+		}
+	}
+};
+
+#endif /* ENUMERARANKS_H_ */
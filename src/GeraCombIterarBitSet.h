@@ -9,6 +9,7 @@
 #define GERACOMBITERARBITSET_H_
 #include <vector>
 #include <boost/dynamic_bitset.hpp>
+#include "Binomial.h"
 
 class GeraCombIterarBitset {
 private:
@@ -58,19 +59,7 @@ public:
 
 	size_t size()
 	{
-
-		uint64_t b[entrada.size()+1];
-
-		b[0] = 1;
-
-		for (uint64_t i = 1; i <= entrada.size(); ++i) {
-			b[i] = 1;
-			for (uint64_t j = i - 1; j > 0; --j) {
-			b[j] += b[j-1];
-			}
-		}
-
-		return b[numero];
+		return binomial(entrada.size(), numero);
 	}
 
 	bool hasNext() {
@@ -0,0 +1,200 @@
+/*
+ * GrafoEmDisco.h
+ *
+ * Grafo ticket <-> garantia guardado em disco, para instancias cuja
+ * adjacencia nao cabe na memoria (25/15/11 tem ~4,5 bilhoes de arestas de
+ * cada lado). Os dois lados tem grau fixo - C(T, M) garantias por ticket e
+ * C(R - M, T - M) tickets por garantia -, entao cada lado e um arquivo plano
+ * em que a lista do no i comeca em i * grau, e um shard e uma faixa contigua
+ * de ranks de nos. Os shards lidos ficam num cache LRU com teto em bytes; o
+ * resto fica no disco.
+ *
+ * O arquivo e montado direto a partir dos ranks das combinacoes (a ordem de
+ * generateAllCombos), sem passar pelo grafo em memoria: a lista de cada no
+ * sai em ordem crescente, igual a de generateNodes, e o guloso sobre este
+ * grafo escolhe como o generico.
+ */
+
+#ifndef GRAFOEMDISCO_H_
+#define GRAFOEMDISCO_H_
+#include <vector>
+#include <list>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <unordered_map>
+#include <algorithm>
+#include <stdint.h>
+#include "Binomial.h"
+#include "EnumeraRanks.h"
+
+template <class Indice>
+class GrafoEmDisco {
+public:
+	GrafoEmDisco(size_t range, size_t ticket_size, size_t match_size, const std::string& dir,
+	             uint64_t bytes_cache, uint64_t bytes_shard)
+		: range(range), ticket_size(ticket_size), match_size(match_size),
+		  max_shards_cache(0), leituras(0), acertos(0) {
+		std::string prefixo = dir + "/grafo_" + std::to_string(range) + "_" + std::to_string(ticket_size) +
+		                      "_" + std::to_string(match_size);
+		lados[0].nome = prefixo + "_tickets.bin";
+		lados[0].qtd_nos = binomial(range, ticket_size);
+		lados[0].grau = binomial(ticket_size, match_size);
+		lados[1].nome = prefixo + "_garantias.bin";
+		lados[1].qtd_nos = binomial(range, match_size);
+		lados[1].grau = binomial(range - match_size, ticket_size - match_size);
+
+		for (int l = 0; l < 2; ++l) {
+			uint64_t bytes_no = lados[l].grau * sizeof(Indice);
+			lados[l].nos_por_shard = std::max<uint64_t>(bytes_shard / bytes_no, 1);
+		}
+		// Pelo menos dois shards: a lista devolvida continua valida durante
+		// a consulta seguinte
+		uint64_t maior_shard = std::max(bytesShard(0), bytesShard(1));
+		max_shards_cache = std::max<uint64_t>(bytes_cache / maior_shard, 2);
+	}
+
+	~GrafoEmDisco() {
+		for (int l = 0; l < 2; ++l) {
+			if (lados[l].arq.is_open()) lados[l].arq.close();
+			std::remove(lados[l].nome.c_str());
+		}
+	}
+
+	/**
+	 * Grava os dois lados do grafo. Devolve false se nao conseguiu criar ou
+	 * escrever os arquivos.
+	 **/
+	bool constroi() {
+		return constroiLado(0) && constroiLado(1);
+	}
+
+	uint64_t qtdTickets() const { return lados[0].qtd_nos; }
+	uint64_t qtdGarantias() const { return lados[1].qtd_nos; }
+	size_t grauTicket() const { return lados[0].grau; }
+	size_t grauGarantia() const { return lados[1].grau; }
+
+	uint64_t bytesEmDisco() const {
+		return (lados[0].qtd_nos * lados[0].grau + lados[1].qtd_nos * lados[1].grau) * sizeof(Indice);
+	}
+	uint64_t bytesCache() const { return max_shards_cache * std::max(bytesShard(0), bytesShard(1)); }
+	uint64_t shardsLidos() const { return leituras; }
+	uint64_t acertosCache() const { return acertos; }
+
+	// Listas de adjacencia; o ponteiro vale ate a segunda consulta seguinte.
+	// NULL se o shard nao pode ser lido do disco
+	const Indice* garantiasDoTicket(uint64_t ticket) { return lista(0, ticket); }
+	const Indice* ticketsDaGarantia(uint64_t garantia) { return lista(1, garantia); }
+
+private:
+	struct Lado {
+		std::string nome;
+		std::fstream arq;
+		uint64_t qtd_nos;
+		uint64_t grau;
+		uint64_t nos_por_shard;
+	};
+
+	struct Shard {
+		uint64_t chave;
+		std::vector<Indice> dados;
+	};
+
+	size_t range, ticket_size, match_size;
+	Lado lados[2];
+	std::list<Shard> lru;   ///< mais recente na frente
+	std::unordered_map<uint64_t, typename std::list<Shard>::iterator> no_cache;
+	uint64_t max_shards_cache;
+	uint64_t leituras, acertos;
+
+	uint64_t bytesShard(int l) const { return lados[l].nos_por_shard * lados[l].grau * sizeof(Indice); }
+
+	const Indice* lista(int l, uint64_t no) {
+		const Lado& lado = lados[l];
+		uint64_t shard = no / lado.nos_por_shard;
+		uint64_t chave = shard * 2 + l;
+
+		typename std::unordered_map<uint64_t, typename std::list<Shard>::iterator>::iterator achou = no_cache.find(chave);
+		if (achou != no_cache.end()) {
+			++acertos;
+			lru.splice(lru.begin(), lru, achou->second);
+		} else if (!carrega(l, shard, chave)) {
+			return NULL;
+		}
+		return &lru.front().dados[(no - shard * lado.nos_por_shard) * lado.grau];
+	}
+
+	// Le o shard para a frente do LRU, reaproveitando o buffer do mais antigo.
+	// Numa leitura curta ou com erro o shard sai do cache e devolve false
+	bool carrega(int l, uint64_t shard, uint64_t chave) {
+		Lado& lado = lados[l];
+		if (lru.size() >= max_shards_cache) {
+			no_cache.erase(lru.back().chave);
+			lru.splice(lru.begin(), lru, --lru.end());
+		} else {
+			lru.push_front(Shard());
+		}
+		Shard& s = lru.front();
+		s.chave = chave;
+		no_cache[chave] = lru.begin();
+
+		uint64_t primeiro = shard * lado.nos_por_shard;
+		uint64_t qtd = std::min(lado.nos_por_shard, lado.qtd_nos - primeiro);
+		s.dados.resize(qtd * lado.grau);
+		lado.arq.clear();
+		if (lado.arq.seekg(static_cast<std::streamoff>(primeiro * lado.grau * sizeof(Indice))) &&
+		    lado.arq.read(reinterpret_cast<char*>(&s.dados[0]), s.dados.size() * sizeof(Indice))) {
+			++leituras;
+			return true;
+		}
+		no_cache.erase(chave);
+		lru.pop_front();
+		return false;
+	}
+
+	/**
+	 * Lado 0: para cada ticket (em ordem de rank), os ranks dos seus
+	 * M-subconjuntos. Lado 1: para cada garantia, os ranks dos tickets que a
+	 * contem (a garantia fixa, completada com T - M das outras dezenas).
+	 **/
+	bool constroiLado(int l) {
+		Lado& lado = lados[l];
+		size_t tam_no = l == 0 ? ticket_size : match_size;
+		EnumeraRanks ranks(range, l == 0 ? match_size : ticket_size);
+		std::vector<size_t> posicoes(tam_no);
+		std::vector<Indice> buffer;
+		buffer.reserve(lado.nos_por_shard * lado.grau);
+
+		std::ofstream saida(lado.nome.c_str(), std::ios::binary | std::ios::trunc);
+		if (!saida) return false;
+
+		for (size_t i = 0; i < tam_no; ++i) posicoes[i] = i;
+		for (uint64_t no = 0; no < lado.qtd_nos; ++no) {
+			ranks.limpa();
+			if (l == 1)
+				for (size_t x = 0; x < range; ++x) ranks.marca(x, EnumeraRanks::CLASSE_B);
+			for (size_t i = 0; i < tam_no; ++i)
+				ranks.marca(posicoes[i], EnumeraRanks::CLASSE_A);
+			ranks.enumera(match_size, buffer);
+
+			if (buffer.size() >= lado.nos_por_shard * lado.grau || no + 1 == lado.qtd_nos) {
+				saida.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Indice));
+				if (!saida) return false;
+				buffer.clear();
+			}
+
+			// Proxima combinacao de tam_no posicoes em ordem lexicografica
+			size_t i = tam_no;
+			while (i > 0 && posicoes[i - 1] == range - tam_no + i - 1) --i;
+			if (i == 0) break;
+			++posicoes[i - 1];
+			for (size_t j = i; j < tam_no; ++j) posicoes[j] = posicoes[j - 1] + 1;
+		}
+		saida.close();
+
+		lado.arq.open(lado.nome.c_str(), std::ios::in | std::ios::binary);
+		return lado.arq.is_open();
+	}
+};
+
+#endif /* GRAFOEMDISCO_H_ */
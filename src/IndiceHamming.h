@@ -0,0 +1,134 @@
+/*
+ * IndiceHamming.h
+ *
+ * Indice de vizinhanca por distancia de Hamming entre mascaras de dezenas
+ * (multi-index hashing). Dois jogos de T dezenas tem pelo menos M em comum
+ * exatamente quando as mascaras distam no maximo 2 (T - M), entao "quem cobre
+ * quem" vira uma consulta de raio.
+ *
+ * A mascara e cortada em B blocos contiguos e cada bloco tem a sua tabela
+ * chave -> jogos. Se duas mascaras distam no maximo d, algum bloco dista no
+ * maximo d / B (casa dos pombos), entao a consulta so visita, em cada bloco,
+ * os baldes das chaves a essa distancia da chave do jogo procurado e confere
+ * a distancia inteira nos candidatos. Com B = d + 1 basta a chave exata. O
+ * custo fica perto do tamanho da resposta, no lugar de varrer os n jogos.
+ */
+
+#ifndef INDICEHAMMING_H_
+#define INDICEHAMMING_H_
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdint.h>
+#include <boost/dynamic_bitset.hpp>
+#include "MascaraDezenas.h"
+
+template <class M>
+class IndiceHamming {
+public:
+	// Mascaras de 'dezenas' bits, cortadas em 'blocos' (ao menos um a cada 64 bits)
+	IndiceHamming(size_t dezenas, size_t blocos) : maior(0), rodada(0) {
+		size_t qtd = std::min(std::max(std::max<size_t>(blocos, (dezenas + 63) / 64), size_t(1)),
+		                      std::max<size_t>(dezenas, 1));
+		tabelas.resize(qtd);
+		for (size_t b = 0, inicio = 0; b < qtd; ++b) {
+			tabelas[b].inicio = inicio;
+			tabelas[b].largura = dezenas / qtd + (b < dezenas % qtd);
+			inicio += tabelas[b].largura;
+		}
+	}
+
+	static unsigned distancia(const M& a, const M& b) {
+		return mascaraContaBits(a) + mascaraContaBits(b) - 2 * mascaraContaComuns(a, b);
+	}
+
+	// Devolve o id do jogo, na ordem de insercao
+	uint32_t insere(const M& mascara) {
+		uint32_t id = static_cast<uint32_t>(mascaras.size());
+		mascaras.push_back(mascara);
+		visto.push_back(0);
+		maior = std::max(maior, mascaraContaBits(mascara));
+		for (size_t b = 0; b < tabelas.size(); ++b) {
+			Tabela& t = tabelas[b];
+			t.baldes[mascaraBloco(mascara, t.inicio, t.largura)].push_back(id);
+		}
+		return id;
+	}
+
+	size_t tamanho() const { return mascaras.size(); }
+	const M& mascara(size_t id) const { return mascaras[id]; }
+	unsigned maiorJogo() const { return maior; }
+
+	/**
+	 * Chama f(id, distancia) uma vez para cada jogo a distancia <= raio de x
+	 * (incluindo um jogo igual a x).
+	 **/
+	template <class F>
+	void vizinhos(const M& x, size_t raio, F f) {
+		if (++rodada == 0) {
+			std::fill(visto.begin(), visto.end(), 0);
+			rodada = 1;
+		}
+		size_t sobra = raio / tabelas.size();
+		for (size_t b = 0; b < tabelas.size(); ++b) {
+			const Tabela& t = tabelas[b];
+			visitaChaves(t, mascaraBloco(x, t.inicio, t.largura), 0, sobra, x, raio, f);
+		}
+	}
+
+	/**
+	 * Quantos jogos do indice com considera[id] (todos, se vazio) dividem
+	 * exatamente 'comuns' dezenas com x, fora um jogo igual a x.
+	 **/
+	uint64_t contaComuns(const M& x, size_t comuns, const std::vector<bool>& considera) {
+		unsigned bits_x = mascaraContaBits(x);
+		if (bits_x + maior < 2 * comuns) return 0;
+		uint64_t total = 0;
+		vizinhos(x, bits_x + maior - 2 * comuns, [&](uint32_t id, unsigned d) {
+			if (d == 0 || (!considera.empty() && !considera[id])) return;
+			if (mascaraContaComuns(x, mascaras[id]) == comuns) ++total;
+		});
+		return total;
+	}
+
+private:
+	struct Tabela {
+		size_t inicio, largura;
+		std::unordered_map<uint64_t, std::vector<uint32_t> > baldes;
+	};
+
+	std::vector<Tabela> tabelas;
+	std::vector<M> mascaras;
+	std::vector<uint32_t> visto;   ///< rodada em que o jogo ja foi conferido
+	unsigned maior;                ///< mais dezenas num jogo do indice
+	uint32_t rodada;
+
+	// Chaves do bloco a no maximo 'sobra' bits trocados de 'chave', trocando do bit 'de' em diante
+	template <class F>
+	void visitaChaves(const Tabela& t, uint64_t chave, size_t de, size_t sobra, const M& x, size_t raio, F& f) {
+		typename std::unordered_map<uint64_t, std::vector<uint32_t> >::const_iterator achou = t.baldes.find(chave);
+		if (achou != t.baldes.end()) {
+			const std::vector<uint32_t>& ids = achou->second;
+			for (size_t i = 0; i < ids.size(); ++i) {
+				uint32_t id = ids[i];
+				if (visto[id] == rodada) continue;
+				visto[id] = rodada;
+				unsigned d = distancia(x, mascaras[id]);
+				if (d <= raio) f(id, d);
+			}
+		}
+		if (sobra == 0) return;
+		for (size_t bit = de; bit < t.largura; ++bit)
+			visitaChaves(t, chave ^ (UINT64_C(1) << bit), bit + 1, sobra - 1, x, raio, f);
+	}
+};
+
+// Indice com os tickets de generateAllCombos, com o id igual ao indice do ticket
+template <class M>
+inline void indexaTickets(IndiceHamming<M>& indice, const std::vector<boost::dynamic_bitset<> >& tickets)
+{
+	for (size_t i = 0; i < tickets.size(); ++i)
+		indice.insere(mascaraDeBitset<M>(tickets[i]));
+}
+
+#endif /* INDICEHAMMING_H_ */
@@ -0,0 +1,168 @@
+/*
+ * MascaraDezenas.h
+ *
+ * Conjunto de dezenas como mascara de bits de tamanho fixo, sem alocacao: a
+ * dezena i (contando de 0) e o bit i. A largura e escolhida pelo tamanho do
+ * sorteio: uint32_t ate 32 dezenas, uint64_t ate 64, unsigned __int128 ate 128
+ * (quando o compilador tem) e MascaraLarga<N> (N palavras de 64 bits) acima
+ * disso, o que cobre loterias como a Lotomania (100 dezenas) e a Quina (80)
+ * sem cair no boost::dynamic_bitset.
+ *
+ * As operacoes (liga, testa, conta bits, conta dezenas em comum, hash) sao
+ * funcoes sobrecarregadas por largura, entao o codigo que as usa e um template
+ * unico e cada largura tem o seu popcount. M() e sempre a mascara vazia.
+ */
+
+#ifndef MASCARADEZENAS_H_
+#define MASCARADEZENAS_H_
+#include <array>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <boost/dynamic_bitset.hpp>
+
+#define MASCARA_MAX_DEZENAS 256
+
+#if defined(__SIZEOF_INT128__)
+#define MASCARA_TEM_INT128 1
+typedef unsigned __int128 Mascara128;
+#endif
+
+template <size_t N>
+struct MascaraLarga
+{
+	std::array<uint64_t, N> palavras;
+
+	MascaraLarga() { palavras.fill(0); }
+
+	bool operator==(const MascaraLarga& outra) const { return palavras == outra.palavras; }
+};
+
+// Liga / testa a dezena 'bit'
+inline void mascaraLiga(uint32_t& m, size_t bit) { m |= UINT32_C(1) << bit; }
+inline void mascaraLiga(uint64_t& m, size_t bit) { m |= UINT64_C(1) << bit; }
+template <size_t N>
+inline void mascaraLiga(MascaraLarga<N>& m, size_t bit) { m.palavras[bit >> 6] |= UINT64_C(1) << (bit & 63); }
+
+inline bool mascaraTesta(uint32_t m, size_t bit) { return (m >> bit) & 1; }
+inline bool mascaraTesta(uint64_t m, size_t bit) { return (m >> bit) & 1; }
+template <size_t N>
+inline bool mascaraTesta(const MascaraLarga<N>& m, size_t bit) { return (m.palavras[bit >> 6] >> (bit & 63)) & 1; }
+
+// Quantidade de dezenas marcadas
+inline unsigned mascaraContaBits(uint32_t m) { return __builtin_popcount(m); }
+inline unsigned mascaraContaBits(uint64_t m) { return __builtin_popcountll(m); }
+template <size_t N>
+inline unsigned mascaraContaBits(const MascaraLarga<N>& m)
+{
+	unsigned total = 0;
+	for (size_t i = 0; i < N; ++i) total += __builtin_popcountll(m.palavras[i]);
+	return total;
+}
+
+// Quantidade de dezenas em comum entre dois jogos (a intersecao)
+inline unsigned mascaraContaComuns(uint32_t a, uint32_t b) { return __builtin_popcount(a & b); }
+inline unsigned mascaraContaComuns(uint64_t a, uint64_t b) { return __builtin_popcountll(a & b); }
+template <size_t N>
+inline unsigned mascaraContaComuns(const MascaraLarga<N>& a, const MascaraLarga<N>& b)
+{
+	unsigned total = 0;
+	for (size_t i = 0; i < N; ++i) total += __builtin_popcountll(a.palavras[i] & b.palavras[i]);
+	return total;
+}
+
+inline size_t mascaraHash(uint32_t m) { return m; }
+inline size_t mascaraHash(uint64_t m) { return static_cast<size_t>(m ^ (m >> 32)) * 0x9E3779B97F4A7C15ULL; }
+template <size_t N>
+inline size_t mascaraHash(const MascaraLarga<N>& m)
+{
+	size_t h = 0;
+	for (size_t i = 0; i < N; ++i) h = (h ^ mascaraHash(m.palavras[i])) * 0x100000001B3ULL;
+	return h;
+}
+
+// Bits [inicio, inicio + largura) como inteiro, com largura <= 64
+inline uint64_t mascaraBaixos(size_t largura) { return largura >= 64 ? ~UINT64_C(0) : (UINT64_C(1) << largura) - 1; }
+inline uint64_t mascaraBloco(uint32_t m, size_t inicio, size_t largura) { return (m >> inicio) & mascaraBaixos(largura); }
+inline uint64_t mascaraBloco(uint64_t m, size_t inicio, size_t largura) { return (m >> inicio) & mascaraBaixos(largura); }
+template <size_t N>
+inline uint64_t mascaraBloco(const MascaraLarga<N>& m, size_t inicio, size_t largura)
+{
+	uint64_t bloco = 0;
+	for (size_t i = 0; i < largura; ++i)
+		bloco |= static_cast<uint64_t>(mascaraTesta(m, inicio + i)) << i;
+	return bloco;
+}
+
+#ifdef MASCARA_TEM_INT128
+inline void mascaraLiga(Mascara128& m, size_t bit) { m |= static_cast<Mascara128>(1) << bit; }
+inline bool mascaraTesta(Mascara128 m, size_t bit) { return (m >> bit) & 1; }
+inline unsigned mascaraContaBits(Mascara128 m)
+{
+	return __builtin_popcountll(static_cast<uint64_t>(m)) + __builtin_popcountll(static_cast<uint64_t>(m >> 64));
+}
+inline unsigned mascaraContaComuns(Mascara128 a, Mascara128 b) { return mascaraContaBits(a & b); }
+inline uint64_t mascaraBloco(Mascara128 m, size_t inicio, size_t largura)
+{
+	return static_cast<uint64_t>(m >> inicio) & mascaraBaixos(largura);
+}
+inline size_t mascaraHash(Mascara128 m)
+{
+	return mascaraHash(static_cast<uint64_t>(m)) ^ (mascaraHash(static_cast<uint64_t>(m >> 64)) * 31);
+}
+#endif
+
+// Para usar a mascara como chave de unordered_map
+struct HashMascara
+{
+	template <class M> size_t operator()(const M& m) const { return mascaraHash(m); }
+};
+
+// Converte o ticket enumerado por generateAllCombos
+template <class M>
+inline M mascaraDeBitset(const boost::dynamic_bitset<>& bs)
+{
+	M m = M();
+	for (size_t pos = bs.find_first(); pos != boost::dynamic_bitset<>::npos; pos = bs.find_next(pos))
+		mascaraLiga(m, pos);
+	return m;
+}
+
+// Jogo escrito com os numeros das dezenas: o numero x e o bit x
+template <class M>
+inline M mascaraDeDezenas(const std::vector<int>& dezenas)
+{
+	M m = M();
+	for (size_t i = 0; i < dezenas.size(); ++i)
+		mascaraLiga(m, static_cast<size_t>(dezenas[i]));
+	return m;
+}
+
+/**
+ * Chama f.template executa<M>() com a menor mascara que comporta 'dezenas'.
+ * Devolve false se passar de MASCARA_MAX_DEZENAS.
+ **/
+template <class F>
+bool despachaMascara(size_t dezenas, F& f)
+{
+	if (dezenas <= 32) { f.template executa<uint32_t>(); return true; }
+	if (dezenas <= 64) { f.template executa<uint64_t>(); return true; }
+#ifdef MASCARA_TEM_INT128
+	if (dezenas <= 128) { f.template executa<Mascara128>(); return true; }
+#endif
+	if (dezenas <= MASCARA_MAX_DEZENAS) { f.template executa<MascaraLarga<4> >(); return true; }
+	return false;
+}
+
+// Bytes de uma mascara para 'dezenas' dezenas (previsao de memoria)
+inline size_t bytesMascara(size_t dezenas)
+{
+	if (dezenas <= 32) return sizeof(uint32_t);
+	if (dezenas <= 64) return sizeof(uint64_t);
+#ifdef MASCARA_TEM_INT128
+	if (dezenas <= 128) return sizeof(Mascara128);
+#endif
+	return sizeof(MascaraLarga<4>);
+}
+
+#endif /* MASCARADEZENAS_H_ */
@@ -0,0 +1,276 @@
+/*
+ * MotorFixo.h
+ *
+ * Motor do guloso especializado em tempo de compilacao para um problema
+ * (R, T, M) fixo: R dezenas no sorteio, T por ticket e garantia de M acertos.
+ * Com R, T e M conhecidos pelo compilador, o grau de cada no do grafo vira
+ * constante (C(T, M) garantias por ticket e C(R - M, T - M) tickets por
+ * garantia, lidos da tabela de Binomial.h), a adjacencia e guardada em arrays
+ * de tamanho fixo dentro do proprio no, sem um vector por no, e os lacos
+ * internos curtos sao desenrolados por completo. As potencias ficam num
+ * vetor a parte, contiguo, para que a varredura do argmax leia so 4 bytes por
+ * ticket.
+ *
+ * As potencias mantidas sao exatamente as do updatePotentials generico, de
+ * modo que o guloso escolhe da mesma forma nos dois motores. So as
+ * configuracoes de producao listadas em despachaMotorFixo() sao instanciadas;
+ * para qualquer outra o programa continua no motor generico.
+ */
+
+#ifndef MOTORFIXO_H_
+#define MOTORFIXO_H_
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
+#include "wheelgen.h"
+#include "instrumentacao.h"
+#include "PoolThreads.h"
+#include "Binomial.h"
+
+// Chama f(0) ... f(N - 1); desenrolado por completo quando N e pequeno
+template <unsigned N, bool desenrola = (N <= 16)>
+struct ParaCadaFixo {
+	template <class F> static void faz(const F& f) {
+		for (unsigned i = 0; i < N; ++i) f(i);
+	}
+};
+
+template <unsigned N>
+struct ParaCadaFixo<N, true> {
+	template <class F> static void faz(const F& f) {
+		ParaCadaFixo<N - 1, true>::faz(f);
+		f(N - 1);
+	}
+};
+
+template <>
+struct ParaCadaFixo<0, true> {
+	template <class F> static void faz(const F&) {}
+};
+
+template <unsigned R, unsigned T, unsigned M>
+class MotorFixo {
+public:
+	enum {
+		GARANTIAS_POR_TICKET = binomialConst(T, M),
+		TICKETS_POR_GARANTIA = binomialConst(R - M, T - M)
+	};
+
+	static_assert(M < T && T < R, "MotorFixo precisa de M < T < R");
+	static_assert(binomialConst(R, T) < (1ULL << 31) && binomialConst(R, M) < (1ULL << 32),
+	              "os indices do MotorFixo sao de 32 bits");
+
+	struct NoTicket {
+		uint32_t garantias[GARANTIAS_POR_TICKET];
+	};
+
+	struct NoGarantia {
+		uint32_t tickets[TICKETS_POR_GARANTIA];
+	};
+
+private:
+	std::vector<NoTicket> tickets;
+	std::vector<NoGarantia> garantias;
+	std::vector<uint32_t> remaining_coverage;
+	std::vector<uint8_t> is_covered;
+	std::vector<uint32_t> novos_cobertos;
+
+	// Marcas de cobranca do nivel 2, como MarcasNivel2 em wheelgen.cpp
+	struct Marcas {
+		std::vector<uint32_t> marcas;
+		uint32_t epoca;
+		std::vector<uint32_t> tocados;
+		Marcas() : epoca(0) {}
+		uint32_t novaEpoca(size_t qtd) {
+			if (marcas.size() != qtd || epoca == UINT32_MAX) {
+				marcas.assign(qtd, 0);
+				epoca = 0;
+			}
+			return ++epoca;
+		}
+	};
+	Marcas marcas_serial;
+	std::vector<Marcas> marcas_threads;
+	std::unique_ptr<std::atomic<uint32_t>[]> pendentes;
+
+	void decrementa(uint32_t idx, uint32_t qtd) {
+		remaining_coverage[idx] -= std::min<uint32_t>(remaining_coverage[idx], qtd);
+	}
+
+	// Cobra uma vez cada ticket que divide uma garantia com o recem coberto 'idx'
+	void cobraNivel2(uint32_t idx, Marcas& m, std::atomic<uint32_t>* acumula) {
+		uint32_t epoca = m.novaEpoca(tickets.size());
+		m.marcas[idx] = epoca;
+		const uint32_t* gs = tickets[idx].garantias;
+		for (unsigned k = 0; k < GARANTIAS_POR_TICKET; ++k) {
+			const uint32_t* ts = garantias[gs[k]].tickets;
+			ParaCadaFixo<TICKETS_POR_GARANTIA>::faz([&](unsigned l) {
+				uint32_t u = ts[l];
+				if (m.marcas[u] == epoca) return;
+				m.marcas[u] = epoca;
+				if (acumula) {
+					if (acumula[u].fetch_add(1, std::memory_order_relaxed) == 0)
+						m.tocados.push_back(u);
+				} else {
+					decrementa(u, 1);
+				}
+			});
+		}
+	}
+
+public:
+	// Copia o grafo montado por generateNodes para o formato fixo
+	MotorFixo(const std::vector<TicketNode>& ticket_nodes, const std::vector<MatchNode>& garantias_nodes)
+		: tickets(ticket_nodes.size()), garantias(garantias_nodes.size()),
+		  remaining_coverage(ticket_nodes.size()), is_covered(ticket_nodes.size()) {
+		for (size_t i = 0; i < ticket_nodes.size(); ++i) {
+			is_covered[i] = ticket_nodes[i].is_covered;
+			remaining_coverage[i] = ticket_nodes[i].remaining_coverage;
+			std::copy(ticket_nodes[i].match_indexes.begin(), ticket_nodes[i].match_indexes.end(),
+			          tickets[i].garantias);
+		}
+		for (size_t i = 0; i < garantias_nodes.size(); ++i)
+			std::copy(garantias_nodes[i].ticket_indexes.begin(), garantias_nodes[i].ticket_indexes.end(),
+			          garantias[i].tickets);
+	}
+
+	// O grafo tem a forma que este motor espera?
+	static bool compativel(const std::vector<TicketNode>& ticket_nodes, const std::vector<MatchNode>& garantias_nodes) {
+		return ticket_nodes.size() == binomialConst(R, T) && garantias_nodes.size() == binomialConst(R, M) &&
+		       ticket_nodes[0].match_indexes.size() == GARANTIAS_POR_TICKET &&
+		       garantias_nodes[0].ticket_indexes.size() == TICKETS_POR_GARANTIA;
+	}
+
+	size_t qtdTickets() const { return tickets.size(); }
+	uint32_t cobertura(size_t i) const { return remaining_coverage[i]; }
+	bool coberto(size_t i) const { return is_covered[i] != 0; }
+
+	size_t bytes() const {
+		return tickets.capacity() * sizeof(NoTicket) + garantias.capacity() * sizeof(NoGarantia) +
+		       remaining_coverage.capacity() * sizeof(uint32_t) + is_covered.capacity();
+	}
+
+	// Cobranca de um candidato recusado por sobreposicao
+	void cobra(uint32_t idx) { decrementa(idx, 1); }
+
+	// Algum match do ticket ja esta marcado em 'usada'?
+	bool sobrepoe(uint32_t idx, const std::vector<bool>& usada) const {
+		for (unsigned k = 0; k < GARANTIAS_POR_TICKET; ++k)
+			if (usada[tickets[idx].garantias[k]]) return true;
+		return false;
+	}
+
+	void marcaGarantias(uint32_t idx, std::vector<bool>& usada) const {
+		for (unsigned k = 0; k < GARANTIAS_POR_TICKET; ++k)
+			usada[tickets[idx].garantias[k]] = true;
+	}
+
+	/**
+	 * Coloca o ticket na roda e atualiza as potencias como o updatePotentials
+	 * generico. Com um pool, o nivel 2 e dividido entre as threads quando ha
+	 * pelo menos 'limiar' tickets recem cobertos.
+	 **/
+	void seleciona(uint32_t inicio, PoolThreads* pool, size_t limiar) {
+		remaining_coverage[inicio] = 0;
+		is_covered[inicio] = 1;
+
+		novos_cobertos.clear();
+		const uint32_t* gs = tickets[inicio].garantias;
+		for (unsigned k = 0; k < GARANTIAS_POR_TICKET; ++k) {
+			const uint32_t* ts = garantias[gs[k]].tickets;
+			ParaCadaFixo<TICKETS_POR_GARANTIA>::faz([&](unsigned l) {
+				uint32_t u = ts[l];
+				decrementa(u, 1);
+				if (is_covered[u]) return;
+				is_covered[u] = 1;
+				decrementa(u, 1);
+				novos_cobertos.push_back(u);
+			});
+		}
+
+		INSTR_SOMA(INSTR_TICKETS_NIVEL1, novos_cobertos.size());
+
+		if (!pool || pool->tamanho() < 2 || novos_cobertos.size() < limiar) {
+			for (size_t i = 0; i < novos_cobertos.size(); ++i)
+				cobraNivel2(novos_cobertos[i], marcas_serial, NULL);
+			return;
+		}
+
+		if (!pendentes) {
+			pendentes.reset(new std::atomic<uint32_t>[tickets.size()]);
+			for (size_t i = 0; i < tickets.size(); ++i)
+				pendentes[i].store(0, std::memory_order_relaxed);
+		}
+		marcas_threads.resize(pool->tamanho());
+		std::atomic<uint32_t>* acumula = pendentes.get();
+
+		pool->executa(novos_cobertos.size(), [&](size_t ini, size_t fim, size_t id) {
+			Marcas& m = marcas_threads[id];
+			m.tocados.clear();
+			for (size_t i = ini; i < fim; ++i)
+				cobraNivel2(novos_cobertos[i], m, acumula);
+		});
+		pool->executa(pool->tamanho(), [&](size_t ini, size_t fim, size_t) {
+			for (size_t id = ini; id < fim; ++id) {
+				const std::vector<uint32_t>& tocados = marcas_threads[id].tocados;
+				for (size_t i = 0; i < tocados.size(); ++i)
+					decrementa(tocados[i], acumula[tocados[i]].exchange(0, std::memory_order_relaxed));
+			}
+		});
+
+		INSTR_CONTA(INSTR_ATUALIZACOES_PARALELAS);
+	}
+
+	// Mesmo argmax de findBestCoverageTickets
+	uint32_t melhores(std::vector<uint64_t>& idxs) const {
+		uint32_t melhor = 0;
+		idxs.clear();
+		INSTR_CONTA(INSTR_VARREDURAS_SELECAO);
+		for (size_t i = 0; i < remaining_coverage.size(); ++i) {
+			uint32_t cobertura = remaining_coverage[i];
+			if (cobertura > melhor) {
+				idxs.clear();
+				idxs.push_back(i);
+				melhor = cobertura;
+			} else if (cobertura == melhor) {
+				idxs.push_back(i);
+			}
+		}
+		INSTR_SOMA(INSTR_EMPATES_SOMA, idxs.size());
+		INSTR_MAXIMO(INSTR_EMPATES_MAXIMO, idxs.size());
+		return melhor;
+	}
+};
+
+/**
+ * Chama f.template executa<R, T, M>() para a configuracao (r, t, m), se ela
+ * estiver entre as instanciadas. Devolve false quando nao esta, e quem chamou
+ * segue com o motor generico.
+ **/
+template <class F>
+bool despachaMotorFixo(size_t r, size_t t, size_t m, F& f)
+{
+	if (t == 15 && m == 14) {
+		switch (r) {
+		case 16: f.template executa<16, 15, 14>(); return true;
+		case 17: f.template executa<17, 15, 14>(); return true;
+		case 18: f.template executa<18, 15, 14>(); return true;
+		case 19: f.template executa<19, 15, 14>(); return true;
+		case 20: f.template executa<20, 15, 14>(); return true;
+		case 21: f.template executa<21, 15, 14>(); return true;
+		}
+	}
+	if (r == 25 && t == 15) {
+		switch (m) {
+		case 11: f.template executa<25, 15, 11>(); return true;
+		case 12: f.template executa<25, 15, 12>(); return true;
+		case 13: f.template executa<25, 15, 13>(); return true;
+		case 14: f.template executa<25, 15, 14>(); return true;
+		}
+	}
+	return false;
+}
+
+#endif /* MOTORFIXO_H_ */
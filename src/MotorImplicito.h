@@ -0,0 +1,159 @@
+/*
+ * MotorImplicito.h
+ *
+ * Motor do guloso sem grafo guardado: as garantias de um ticket sao os seus
+ * C(T, M) M-subconjuntos e os tickets de uma garantia sao os seus
+ * C(R - M, T - M) superconjuntos, entao as listas de adjacencia sao geradas
+ * na hora a partir do rank (EnumeraRanks). So o estado de cada ticket fica na
+ * memoria: o potencial (um Indice) e um bit de coberto.
+ *
+ * As duas camadas do updatePotentials viram "tickets com exatamente j
+ * dezenas em comum", para j de M a T: cada vizinho aparece uma vez so, e quem
+ * divide C(j, M) garantias com o ticket selecionado recebe as C(j, M)
+ * cobrancas de uma vez (os decrementos saturam, entao da na mesma). No nivel
+ * 2 isso dispensa as marcas de cobranca repetida. As potencias mantidas sao
+ * as do updatePotentials generico.
+ */
+
+#ifndef MOTORIMPLICITO_H_
+#define MOTORIMPLICITO_H_
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include "EnumeraRanks.h"
+#include "Binomial.h"
+#include "combinacao.h"
+#include "instrumentacao.h"
+#include "PoolThreads.h"
+
+template <class Indice>
+class MotorImplicito {
+public:
+	MotorImplicito(size_t range, size_t ticket_size, size_t match_size)
+		: range(range), ticket_size(ticket_size), match_size(match_size),
+		  ranks_tickets(range, ticket_size), ranks_garantias(range, match_size), posicoes(ticket_size),
+		  remaining_coverage(binomial(range, ticket_size),
+		                     computeStartingCoverage(range, ticket_size, match_size)),
+		  is_covered(remaining_coverage.size(), false) {}
+
+	uint64_t qtdTickets() const { return remaining_coverage.size(); }
+	uint64_t qtdGarantias() const { return binomial(range, match_size); }
+	Indice cobertura(size_t i) const { return remaining_coverage[i]; }
+	bool coberto(size_t i) const { return is_covered[i]; }
+
+	size_t bytes() const {
+		return remaining_coverage.capacity() * sizeof(Indice) + is_covered.capacity() / 8;
+	}
+
+	// Listas de adjacencia, na ordem de generateNodes; valem ate a proxima consulta
+	const std::vector<Indice>& garantiasDoTicket(uint64_t ticket) {
+		ranks_tickets.desfazRank(ticket, ticket_size, &posicoes[0]);
+		ranks_garantias.limpa();
+		for (size_t i = 0; i < ticket_size; ++i) ranks_garantias.marca(posicoes[i], EnumeraRanks::CLASSE_A);
+		lista.clear();
+		ranks_garantias.enumera(match_size, lista);
+		return lista;
+	}
+
+	const std::vector<Indice>& ticketsDaGarantia(uint64_t garantia) {
+		ranks_tickets.desfazRank(garantia, match_size, &posicoes[0]);
+		for (size_t x = 0; x < range; ++x) ranks_tickets.marca(x, EnumeraRanks::CLASSE_B);
+		for (size_t i = 0; i < match_size; ++i) ranks_tickets.marca(posicoes[i], EnumeraRanks::CLASSE_A);
+		lista.clear();
+		ranks_tickets.enumera(match_size, lista);
+		return lista;
+	}
+
+	// Cobranca de um candidato recusado por sobreposicao
+	void cobra(uint64_t idx) { decrementa(idx, 1); }
+
+	bool sobrepoe(uint64_t idx, const std::vector<bool>& usada) {
+		const std::vector<Indice>& gs = garantiasDoTicket(idx);
+		for (size_t k = 0; k < gs.size(); ++k)
+			if (usada[gs[k]]) return true;
+		return false;
+	}
+
+	void marcaGarantias(uint64_t idx, std::vector<bool>& usada) {
+		const std::vector<Indice>& gs = garantiasDoTicket(idx);
+		for (size_t k = 0; k < gs.size(); ++k) usada[gs[k]] = true;
+	}
+
+	/**
+	 * Coloca o ticket na roda e atualiza as potencias como o updatePotentials
+	 * generico. A geracao dos vizinhos usa um unico enumerador, entao este
+	 * motor roda sem o pool.
+	 **/
+	void seleciona(uint64_t inicio, PoolThreads*, size_t) {
+		remaining_coverage[inicio] = 0;
+		is_covered[inicio] = true;
+
+		novos_cobertos.clear();
+		for (size_t j = match_size; j <= ticket_size; ++j) {
+			uint64_t cobranca = binomial(j, match_size);
+			const std::vector<Indice>& us = vizinhos(inicio, j);
+			for (size_t i = 0; i < us.size(); ++i) {
+				Indice u = us[i];
+				decrementa(u, cobranca);
+				if (is_covered[u]) continue;
+				is_covered[u] = true;
+				decrementa(u, 1);
+				novos_cobertos.push_back(u);
+			}
+		}
+
+		INSTR_SOMA(INSTR_TICKETS_NIVEL1, novos_cobertos.size());
+
+		for (size_t n = 0; n < novos_cobertos.size(); ++n) {
+			for (size_t j = match_size; j < ticket_size; ++j) {
+				const std::vector<Indice>& ws = vizinhos(novos_cobertos[n], j);
+				for (size_t i = 0; i < ws.size(); ++i) decrementa(ws[i], 1);
+			}
+		}
+	}
+
+	// Mesmo argmax de findBestCoverageTickets
+	Indice melhores(std::vector<uint64_t>& idxs) const {
+		Indice melhor = 0;
+		idxs.clear();
+		INSTR_CONTA(INSTR_VARREDURAS_SELECAO);
+		for (size_t i = 0; i < remaining_coverage.size(); ++i) {
+			Indice cobertura = remaining_coverage[i];
+			if (cobertura > melhor) {
+				idxs.clear();
+				idxs.push_back(i);
+				melhor = cobertura;
+			} else if (cobertura == melhor) {
+				idxs.push_back(i);
+			}
+		}
+		INSTR_SOMA(INSTR_EMPATES_SOMA, idxs.size());
+		INSTR_MAXIMO(INSTR_EMPATES_MAXIMO, idxs.size());
+		return melhor;
+	}
+
+private:
+	size_t range, ticket_size, match_size;
+	EnumeraRanks ranks_tickets, ranks_garantias;
+	std::vector<size_t> posicoes;
+	std::vector<Indice> lista;
+	std::vector<Indice> remaining_coverage;
+	std::vector<bool> is_covered;
+	std::vector<uint64_t> novos_cobertos;
+
+	void decrementa(uint64_t idx, uint64_t qtd) {
+		remaining_coverage[idx] -= static_cast<Indice>(std::min<uint64_t>(remaining_coverage[idx], qtd));
+	}
+
+	// Tickets com exatamente 'comuns' dezenas em comum com o ticket 'idx'
+	const std::vector<Indice>& vizinhos(uint64_t idx, size_t comuns) {
+		ranks_tickets.desfazRank(idx, ticket_size, &posicoes[0]);
+		for (size_t x = 0; x < range; ++x) ranks_tickets.marca(x, EnumeraRanks::CLASSE_B);
+		for (size_t i = 0; i < ticket_size; ++i) ranks_tickets.marca(posicoes[i], EnumeraRanks::CLASSE_A);
+		lista.clear();
+		ranks_tickets.enumera(comuns, lista);
+		return lista;
+	}
+};
+
+#endif /* MOTORIMPLICITO_H_ */
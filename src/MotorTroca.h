@@ -0,0 +1,228 @@
+/*
+ * MotorTroca.h
+ *
+ * Motor do guloso para a garantia M = T - 1 (a Lotofacil "14 de 15"). Nesse
+ * caso dois tickets dividem uma garantia exatamente quando um sai do outro
+ * trocando uma dezena (tira uma de dentro, poe uma de fora), e dividem uma so.
+ * Entao os vizinhos de um ticket sao as T * (R - T) trocas, sem repeticao, e
+ * os nos de garantia nem precisam existir.
+ *
+ * O rank de cada troca sai em O(1): com o rank de p_0 < ... < p_{T-1} escrito
+ * como C(R, T) - 1 - soma C(R - 1 - p_i, T - i), tirar p_a e por q so desloca
+ * de uma posicao os termos entre p_a e q, e as somas prefixadas dos termos
+ * com e sem deslocamento sao montadas uma vez por ticket. As garantias do
+ * ticket (para a sobreposicao) saem do mesmo jeito.
+ *
+ * As potencias mantidas sao as do updatePotentials generico.
+ */
+
+#ifndef MOTORTROCA_H_
+#define MOTORTROCA_H_
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
+#include "EnumeraRanks.h"
+#include "Binomial.h"
+#include "combinacao.h"
+#include "instrumentacao.h"
+#include "PoolThreads.h"
+
+template <class Indice>
+class MotorTroca {
+public:
+	MotorTroca(size_t range, size_t ticket_size)
+		: n(range), k(ticket_size), ranks(range, ticket_size), tabela(range * (ticket_size + 2)),
+		  total_tickets(binomial(range, ticket_size)), total_garantias(binomial(range, ticket_size - 1)),
+		  remaining_coverage(total_tickets, computeStartingCoverage(range, ticket_size, ticket_size - 1)),
+		  is_covered(total_tickets, 0) {
+		for (size_t a = 0; a < n; ++a)
+			for (size_t b = 0; b <= k + 1; ++b)
+				tabela[a * (k + 2) + b] = binomial(a, b);
+	}
+
+	uint64_t qtdTickets() const { return total_tickets; }
+	uint64_t qtdGarantias() const { return total_garantias; }
+	Indice cobertura(size_t i) const { return remaining_coverage[i]; }
+	bool coberto(size_t i) const { return is_covered[i] != 0; }
+
+	size_t bytes() const {
+		return remaining_coverage.capacity() * sizeof(Indice) + is_covered.capacity();
+	}
+
+	// Cobranca de um candidato recusado por sobreposicao
+	void cobra(uint64_t idx) { decrementa(idx, 1); }
+
+	bool sobrepoe(uint64_t idx, const std::vector<bool>& usada) {
+		carrega(idx, troca_serial);
+		for (size_t a = 0; a < k; ++a)
+			if (usada[garantia(troca_serial, a)]) return true;
+		return false;
+	}
+
+	void marcaGarantias(uint64_t idx, std::vector<bool>& usada) {
+		carrega(idx, troca_serial);
+		for (size_t a = 0; a < k; ++a) usada[garantia(troca_serial, a)] = true;
+	}
+
+	/**
+	 * Coloca o ticket na roda e atualiza as potencias como o updatePotentials
+	 * generico: cada troca do ticket perde uma unidade e, se ainda nao estava
+	 * coberta, fica coberta e perde mais uma; depois cada troca de cada recem
+	 * coberto perde uma. Com um pool, esse segundo nivel e dividido entre as
+	 * threads quando ha pelo menos 'limiar' recem cobertos.
+	 **/
+	void seleciona(uint64_t inicio, PoolThreads* pool, size_t limiar) {
+		remaining_coverage[inicio] = 0;
+		is_covered[inicio] = 1;
+
+		novos_cobertos.clear();
+		carrega(inicio, troca_serial);
+		paraCadaTroca(troca_serial, [&](uint64_t u) {
+			decrementa(u, 1);
+			if (is_covered[u]) return;
+			is_covered[u] = 1;
+			decrementa(u, 1);
+			novos_cobertos.push_back(u);
+		});
+
+		INSTR_SOMA(INSTR_TICKETS_NIVEL1, novos_cobertos.size());
+
+		if (!pool || pool->tamanho() < 2 || novos_cobertos.size() < limiar) {
+			for (size_t i = 0; i < novos_cobertos.size(); ++i) {
+				carrega(novos_cobertos[i], troca_serial);
+				paraCadaTroca(troca_serial, [&](uint64_t w) { decrementa(w, 1); });
+			}
+			return;
+		}
+
+		if (!pendentes) {
+			pendentes.reset(new std::atomic<uint32_t>[total_tickets]);
+			for (size_t i = 0; i < total_tickets; ++i)
+				pendentes[i].store(0, std::memory_order_relaxed);
+		}
+		trocas_threads.resize(pool->tamanho());
+		std::atomic<uint32_t>* acumula = pendentes.get();
+
+		pool->executa(novos_cobertos.size(), [&](size_t ini, size_t fim, size_t id) {
+			Troca& tr = trocas_threads[id];
+			tr.tocados.clear();
+			for (size_t i = ini; i < fim; ++i) {
+				carrega(novos_cobertos[i], tr);
+				paraCadaTroca(tr, [&](uint64_t w) {
+					if (acumula[w].fetch_add(1, std::memory_order_relaxed) == 0)
+						tr.tocados.push_back(w);
+				});
+			}
+		});
+		pool->executa(pool->tamanho(), [&](size_t ini, size_t fim, size_t) {
+			for (size_t id = ini; id < fim; ++id) {
+				const std::vector<uint64_t>& tocados = trocas_threads[id].tocados;
+				for (size_t i = 0; i < tocados.size(); ++i)
+					decrementa(tocados[i], acumula[tocados[i]].exchange(0, std::memory_order_relaxed));
+			}
+		});
+
+		INSTR_CONTA(INSTR_ATUALIZACOES_PARALELAS);
+	}
+
+	// Mesmo argmax de findBestCoverageTickets
+	Indice melhores(std::vector<uint64_t>& idxs) const {
+		Indice melhor = 0;
+		idxs.clear();
+		INSTR_CONTA(INSTR_VARREDURAS_SELECAO);
+		for (size_t i = 0; i < remaining_coverage.size(); ++i) {
+			Indice cobertura = remaining_coverage[i];
+			if (cobertura > melhor) {
+				idxs.clear();
+				idxs.push_back(i);
+				melhor = cobertura;
+			} else if (cobertura == melhor) {
+				idxs.push_back(i);
+			}
+		}
+		INSTR_SOMA(INSTR_EMPATES_SOMA, idxs.size());
+		INSTR_MAXIMO(INSTR_EMPATES_MAXIMO, idxs.size());
+		return melhor;
+	}
+
+private:
+	// Ticket carregado: posicoes, dezenas de fora e as somas prefixadas dos
+	// termos do rank sem deslocamento (s0), com o indice uma posicao antes
+	// (s_antes) e uma depois (s_depois). Uma por thread.
+	struct Troca {
+		std::vector<size_t> pos;
+		std::vector<size_t> fora;
+		std::vector<size_t> antes_de;   ///< quantas dezenas do ticket ficam antes de fora[j]
+		std::vector<uint64_t> s0, s_antes, s_depois;
+		std::vector<uint64_t> tocados;
+	};
+
+	size_t n, k;
+	EnumeraRanks ranks;
+	std::vector<uint64_t> tabela;   ///< tabela[a * (k + 2) + b] = C(a, b)
+	uint64_t total_tickets, total_garantias;
+	std::vector<Indice> remaining_coverage;
+	std::vector<uint8_t> is_covered;
+	std::vector<uint64_t> novos_cobertos;
+	Troca troca_serial;
+	std::vector<Troca> trocas_threads;
+	std::unique_ptr<std::atomic<uint32_t>[]> pendentes;
+
+	uint64_t C(size_t a, size_t b) const { return tabela[a * (k + 2) + b]; }
+
+	void decrementa(uint64_t idx, uint64_t qtd) {
+		remaining_coverage[idx] -= static_cast<Indice>(std::min<uint64_t>(remaining_coverage[idx], qtd));
+	}
+
+	void carrega(uint64_t idx, Troca& tr) const {
+		tr.pos.resize(k);
+		ranks.desfazRank(idx, k, &tr.pos[0]);
+		tr.s0.assign(k + 1, 0);
+		tr.s_antes.assign(k + 1, 0);
+		tr.s_depois.assign(k + 1, 0);
+		for (size_t i = 0; i < k; ++i) {
+			size_t resto = n - 1 - tr.pos[i];
+			tr.s0[i + 1] = tr.s0[i] + C(resto, k - i);
+			tr.s_antes[i + 1] = tr.s_antes[i] + C(resto, k - i + 1);
+			tr.s_depois[i + 1] = tr.s_depois[i] + C(resto, k - i - 1);
+		}
+		tr.fora.clear();
+		tr.antes_de.clear();
+		for (size_t x = 0, i = 0; x < n; ++x) {
+			if (i < k && tr.pos[i] == x) { ++i; continue; }
+			tr.fora.push_back(x);
+			tr.antes_de.push_back(i);
+		}
+	}
+
+	// Rank da garantia que sobra ao tirar pos[a]
+	uint64_t garantia(const Troca& tr, size_t a) const {
+		return total_garantias - 1 - (tr.s_depois[a] + tr.s0[k] - tr.s0[a + 1]);
+	}
+
+	// Chama f(rank) para cada ticket que tira pos[a] e poe fora[j]
+	template <class F>
+	void paraCadaTroca(const Troca& tr, const F& f) const {
+		for (size_t a = 0; a < k; ++a) {
+			for (size_t j = 0; j < tr.fora.size(); ++j) {
+				size_t q = tr.fora[j];
+				size_t b = tr.antes_de[j];
+				uint64_t soma;
+				if (q > tr.pos[a]) {
+					// pos[a+1 .. b-1] sobem uma posicao no indice; q fica em b - 1
+					soma = tr.s0[a] + (tr.s_antes[b] - tr.s_antes[a + 1]) + C(n - 1 - q, k - b + 1) +
+					       (tr.s0[k] - tr.s0[b]);
+				} else {
+					// pos[b .. a-1] descem uma posicao no indice; q fica em b
+					soma = tr.s0[b] + C(n - 1 - q, k - b) + (tr.s_depois[a] - tr.s_depois[b]) +
+					       (tr.s0[k] - tr.s0[a + 1]);
+				}
+				f(total_tickets - 1 - soma);
+			}
+		}
+	}
+};
+
+#endif /* MOTORTROCA_H_ */
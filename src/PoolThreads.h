@@ -0,0 +1,103 @@
+/*
+ * PoolThreads.h
+ *
+ * Pool fixo de threads para dividir um laco em blocos contiguos. As threads
+ * sao criadas uma vez e ficam esperando trabalho, entao o custo por chamada
+ * de executa() e so o de acordar e esperar as threads, o que permite usar o
+ * pool dentro do laco do guloso.
+ */
+
+#ifndef POOLTHREADS_H_
+#define POOLTHREADS_H_
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdint.h>
+
+class PoolThreads {
+public:
+	typedef std::function<void(size_t inicio, size_t fim, size_t id_thread)> Tarefa;
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mtx;
+	std::condition_variable cv_inicio;
+	std::condition_variable cv_fim;
+	const Tarefa* tarefa_atual;
+	size_t qtd_itens_atual;
+	uint64_t geracao;
+	size_t pendentes;
+	bool encerrando;
+
+	// Bloco [inicio, fim) do item 'id' de 'qtd' participantes
+	static void bloco(size_t qtd_itens, size_t id, size_t qtd, size_t& inicio, size_t& fim) {
+		inicio = qtd_itens * id / qtd;
+		fim = qtd_itens * (id + 1) / qtd;
+	}
+
+	void trabalha(size_t id) {
+		uint64_t vista = 0;
+		while (true) {
+			const Tarefa* tarefa;
+			size_t qtd_itens;
+			{
+				std::unique_lock<std::mutex> trava(mtx);
+				cv_inicio.wait(trava, [&]() { return encerrando || geracao != vista; });
+				if (encerrando) return;
+				vista = geracao;
+				tarefa = tarefa_atual;
+				qtd_itens = qtd_itens_atual;
+			}
+
+			size_t inicio, fim;
+			bloco(qtd_itens, id, tamanho(), inicio, fim);
+			if (inicio < fim) (*tarefa)(inicio, fim, id);
+
+			std::lock_guard<std::mutex> trava(mtx);
+			if (--pendentes == 0) cv_fim.notify_one();
+		}
+	}
+
+public:
+	// 'qtd' participantes contando a thread que chama executa()
+	explicit PoolThreads(size_t qtd)
+		: tarefa_atual(NULL), qtd_itens_atual(0), geracao(0), pendentes(0), encerrando(false) {
+		for (size_t id = 1; id < qtd; ++id)
+			threads.push_back(std::thread(&PoolThreads::trabalha, this, id));
+	}
+
+	~PoolThreads() {
+		{
+			std::lock_guard<std::mutex> trava(mtx);
+			encerrando = true;
+		}
+		cv_inicio.notify_all();
+		for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+	}
+
+	size_t tamanho() const {
+		return threads.size() + 1;
+	}
+
+	// Divide [0, qtd_itens) entre os participantes e volta quando todos terminam
+	void executa(size_t qtd_itens, const Tarefa& tarefa) {
+		{
+			std::lock_guard<std::mutex> trava(mtx);
+			tarefa_atual = &tarefa;
+			qtd_itens_atual = qtd_itens;
+			pendentes = threads.size();
+			++geracao;
+		}
+		cv_inicio.notify_all();
+
+		size_t inicio, fim;
+		bloco(qtd_itens, 0, tamanho(), inicio, fim);
+		if (inicio < fim) tarefa(inicio, fim, 0);
+
+		std::unique_lock<std::mutex> trava(mtx);
+		cv_fim.wait(trava, [&]() { return pendentes == 0; });
+	}
+};
+#endif /* POOLTHREADS_H_ */
@@ -0,0 +1,87 @@
+/*
+ * PrazoBusca.h
+ *
+ * Parada da busca por tempo (--tempo S) ou por sinal (SIGINT/SIGTERM). Os
+ * gulosos consultam deveParar() a cada ticket escolhido: a consulta e um
+ * teste de flag e o relogio so e lido a cada CONSULTAS_POR_LEITURA chamadas.
+ *
+ * O prazo so corta uma tentativa quando ja existe uma roda completa para
+ * devolver (permiteCorte); sem ela a primeira tentativa vai ate o fim. O
+ * sinal corta sempre, e o segundo sinal encerra o programa do jeito normal.
+ */
+
+#ifndef PRAZOBUSCA_H_
+#define PRAZOBUSCA_H_
+#include <csignal>
+#include <chrono>
+#include <stdint.h>
+
+class PrazoBusca {
+public:
+	typedef std::chrono::steady_clock Relogio;
+
+	// Comeca a contar 'segundos' (0 = sem prazo); o corte comeca desligado
+	static void inicia(double segundos) {
+		Estado& e = estado();
+		e.tem_prazo = segundos > 0;
+		e.segundos = segundos;
+		e.fim = Relogio::now() + std::chrono::duration_cast<Relogio::duration>(std::chrono::duration<double>(segundos));
+		e.pode_cortar = false;
+		e.vencido = false;
+		e.consultas = 0;
+	}
+
+	static bool temPrazo() { return estado().tem_prazo; }
+	static double segundos() { return estado().segundos; }
+	static void permiteCorte(bool pode) { estado().pode_cortar = pode; }
+	static bool interrompida() { return sinal() != 0; }
+
+	// Consulta barata, para dentro dos lacos do guloso
+	static bool deveParar() {
+		if (sinal()) return true;
+		Estado& e = estado();
+		if (!e.tem_prazo || !e.pode_cortar) return false;
+		if (!e.vencido && ++e.consultas % CONSULTAS_POR_LEITURA == 0) e.vencido = Relogio::now() >= e.fim;
+		return e.vencido;
+	}
+
+	// Mesma coisa lendo o relogio agora, para entre uma tentativa e outra
+	static bool acabou() {
+		if (sinal()) return true;
+		Estado& e = estado();
+		if (e.tem_prazo && e.pode_cortar && !e.vencido) e.vencido = Relogio::now() >= e.fim;
+		return e.vencido;
+	}
+
+	static void instalaSinais() {
+		std::signal(SIGINT, trataSinal);
+		std::signal(SIGTERM, trataSinal);
+	}
+
+private:
+	enum { CONSULTAS_POR_LEITURA = 16 };
+
+	struct Estado {
+		bool tem_prazo, pode_cortar, vencido;
+		double segundos;
+		Relogio::time_point fim;
+		uint32_t consultas;
+	};
+
+	static Estado& estado() {
+		static Estado e = Estado();
+		return e;
+	}
+
+	static volatile std::sig_atomic_t& sinal() {
+		static volatile std::sig_atomic_t recebido = 0;
+		return recebido;
+	}
+
+	static void trataSinal(int numero) {
+		sinal() = numero;
+		std::signal(numero, SIG_DFL);
+	}
+};
+
+#endif /* PRAZOBUSCA_H_ */
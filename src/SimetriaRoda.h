@@ -0,0 +1,106 @@
+/*
+ * SimetriaRoda.h
+ *
+ * As R dezenas do fechamento sao intercambiaveis: renomear as dezenas leva
+ * uma roda em outra do mesmo tamanho. Entao o primeiro ticket pode ser
+ * sempre o de rank 0, e duas tentativas do guloso cujos primeiros tickets
+ * diferem so por uma renomeacao fazem a mesma busca.
+ *
+ * A classe de um prefixo (os primeiros k tickets, sem importar a ordem) sob
+ * renomeacao das dezenas e dada pela quantidade de dezenas em cada regiao do
+ * diagrama de Venn dos k tickets, tomando a menor dessas contagens entre as
+ * k! ordens dos tickets. PrefixosExplorados guarda as classes ja percorridas
+ * pelas tentativas anteriores e, no desempate dos primeiros tickets, prefere
+ * um candidato que leve a uma classe nova, para que as tentativas de
+ * qtdBusca explorem buscas de fato diferentes.
+ */
+
+#ifndef SIMETRIARODA_H_
+#define SIMETRIARODA_H_
+#include <vector>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <stdint.h>
+#include "EnumeraRanks.h"
+
+#define SIMETRIA_PROFUNDIDADE_MAX 5
+
+class PrefixosExplorados {
+public:
+	PrefixosExplorados(size_t range, size_t ticket_size, size_t profundidade)
+		: range(range), ticket_size(ticket_size),
+		  profundidade(std::min<size_t>(profundidade, SIMETRIA_PROFUNDIDADE_MAX)),
+		  ranks(range, ticket_size), posicoes(ticket_size), codigo(range) {}
+
+	size_t profundidadeMax() const { return profundidade; }
+	size_t qtdClasses() const { return vistos.size(); }
+
+	// Forma canonica dos 'qtd' tickets (ranks de generateAllCombos)
+	std::vector<uint32_t> classe(const uint64_t* tickets, size_t qtd) {
+		std::fill(codigo.begin(), codigo.end(), 0);
+		for (size_t i = 0; i < qtd; ++i) {
+			ranks.desfazRank(tickets[i], ticket_size, &posicoes[0]);
+			for (size_t p = 0; p < ticket_size; ++p) codigo[posicoes[p]] |= 1u << i;
+		}
+		std::vector<uint32_t> contagem(size_t(1) << qtd, 0);
+		for (size_t x = 0; x < range; ++x) ++contagem[codigo[x]];
+
+		size_t ordem[SIMETRIA_PROFUNDIDADE_MAX];
+		for (size_t i = 0; i < qtd; ++i) ordem[i] = i;
+		std::vector<uint32_t> menor, permutada(contagem.size());
+		do {
+			for (size_t c = 0; c < contagem.size(); ++c) {
+				size_t destino = 0;
+				for (size_t i = 0; i < qtd; ++i)
+					if (c >> i & 1) destino |= size_t(1) << ordem[i];
+				permutada[destino] = contagem[c];
+			}
+			if (menor.empty() || permutada < menor) menor = permutada;
+		} while (std::next_permutation(ordem, ordem + qtd));
+		return menor;
+	}
+
+	/**
+	 * Registra as classes dos prefixos da roda ate a profundidade. Devolve
+	 * true se o prefixo mais longo ja tinha sido percorrido antes.
+	 **/
+	bool registra(const std::vector<uint64_t>& roda) {
+		bool repetido = false;
+		for (size_t k = 2; k <= std::min(profundidade, roda.size()); ++k)
+			repetido = !vistos.insert(classe(&roda[0], k)).second;
+		return repetido;
+	}
+
+	/**
+	 * Desempate entre os melhores candidatos. Enquanto a roda tem menos de
+	 * 'profundidade' tickets, sorteia ate TENTATIVAS candidatos e fica com o
+	 * primeiro que leva a um prefixo de classe ainda nao percorrida; senao (ou
+	 * se nenhum leva) fica com o primeiro sorteado, como no desempate normal.
+	 **/
+	template <class Eng>
+	uint64_t escolhe(const std::vector<uint64_t>& roda, const std::vector<uint64_t>& empatados, Eng& eng) {
+		std::uniform_int_distribution<size_t> distr(0, empatados.size() - 1);
+		uint64_t sorteado = empatados[distr(eng)];
+		if (roda.empty() || roda.size() >= profundidade || empatados.size() < 2) return sorteado;
+
+		std::vector<uint64_t> prefixo(roda);
+		prefixo.push_back(sorteado);
+		for (size_t t = 0; t < TENTATIVAS; ++t) {
+			if (t > 0) prefixo.back() = empatados[distr(eng)];
+			if (!vistos.count(classe(&prefixo[0], prefixo.size()))) return prefixo.back();
+		}
+		return sorteado;
+	}
+
+private:
+	enum { TENTATIVAS = 32 };
+
+	size_t range, ticket_size, profundidade;
+	EnumeraRanks ranks;
+	std::vector<size_t> posicoes;
+	std::vector<uint8_t> codigo;   ///< bit i ligado se a dezena esta no i-esimo ticket
+	std::set<std::vector<uint32_t> > vistos;
+};
+
+#endif /* SIMETRIARODA_H_ */
@@ -0,0 +1,78 @@
+/*
+ * SorteioCombinacoes.h
+ *
+ * Sorteio sem repeticao de k-subconjuntos de {1, ..., n} sem montar a lista
+ * das C(n, k) combinacoes: sorteia o rank com um Fisher-Yates esparso (so as
+ * posicoes ja trocadas ficam num mapa) e desfaz so o rank sorteado. Memoria e
+ * tempo ficam proporcionais ao numero de sorteios.
+ *
+ * Com n > BINOMIAL_MAX_N o C(n, k) nao e exato em 64 bits; ai cada sorteio e
+ * um embaralhamento parcial de {1, ..., n}, descartando subconjuntos repetidos.
+ */
+
+#ifndef SORTEIOCOMBINACOES_H_
+#define SORTEIOCOMBINACOES_H_
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <random>
+#include <algorithm>
+#include <stdint.h>
+#include "Binomial.h"
+#include "EnumeraRanks.h"
+
+class SorteioCombinacoes {
+public:
+	SorteioCombinacoes(size_t n, size_t k, uint64_t semente)
+		: n(n), k(k), exato(n <= BINOMIAL_MAX_N), total(exato ? binomial(n, k) : UINT64_MAX),
+		  restam(total), eng(semente), ranks(exato ? n : 1, exato ? k : 0), posicoes(k) {}
+
+	uint64_t restantes() const { return restam; }
+
+	// Proximo subconjunto, em ordem crescente; false quando ja sairam todos
+	bool sorteia(std::vector<int>& dezenas) {
+		if (restam == 0 || k > n) return false;
+		dezenas.resize(k);
+		if (!exato) return sorteiaEmbaralhando(dezenas);
+
+		uint64_t j = std::uniform_int_distribution<uint64_t>(0, restam - 1)(eng);
+		uint64_t rank = posicao(j);
+		trocas[j] = posicao(restam - 1);
+		trocas.erase(restam - 1);
+		--restam;
+
+		if (k > 0) ranks.desfazRank(rank, k, &posicoes[0]);
+		for (size_t i = 0; i < k; ++i) dezenas[i] = static_cast<int>(posicoes[i] + 1);
+		return true;
+	}
+
+private:
+	size_t n, k;
+	bool exato;
+	uint64_t total, restam;
+	std::mt19937_64 eng;
+	EnumeraRanks ranks;
+	std::vector<size_t> posicoes;
+	std::unordered_map<uint64_t, uint64_t> trocas;   ///< posicao -> rank que foi para ela
+	std::vector<int> todas;                          ///< {1..n}, para o caso nao exato
+	std::set<std::vector<int> > vistos;
+
+	uint64_t posicao(uint64_t j) const {
+		std::unordered_map<uint64_t, uint64_t>::const_iterator achou = trocas.find(j);
+		return achou == trocas.end() ? j : achou->second;
+	}
+
+	bool sorteiaEmbaralhando(std::vector<int>& dezenas) {
+		if (todas.empty())
+			for (size_t x = 1; x <= n; ++x) todas.push_back(static_cast<int>(x));
+		do {
+			for (size_t i = 0; i < k; ++i)
+				std::swap(todas[i], todas[std::uniform_int_distribution<size_t>(i, n - 1)(eng)]);
+			std::copy(todas.begin(), todas.begin() + k, dezenas.begin());
+			std::sort(dezenas.begin(), dezenas.end());
+		} while (!vistos.insert(dezenas).second);
+		return true;
+	}
+};
+
+#endif /* SORTEIOCOMBINACOES_H_ */
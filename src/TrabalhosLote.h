@@ -0,0 +1,164 @@
+/*
+ * TrabalhosLote.h
+ *
+ * Lista de trabalhos do modo lote (--trabalhos ARQ): varias configuracoes
+ * rodadas por um processo so, que aproveita entre elas o que for comum (o
+ * universo de tickets, as garantias, o grafo e a biblioteca de rodas).
+ *
+ * Um trabalho por linha, com os mesmos 6 valores posicionais da linha de
+ * comando seguidos de opcoes chave=valor; '#' comeca um comentario:
+ *
+ *   # r  t  m  buscas sobreposicao jogos [semente=N] [filtros=...] [saida=ARQ] [universo=N] [tempo=S]
+ *   16 15 14  20     1            30    semente=7 saida=noite/16_15_14.txt
+ *   21 15 13  0      1            10    filtros=resultados,gap:5 tempo=600
+ *
+ * semente 0 usa o relogio; filtros segue aplicaFiltros(); tempo e o prazo
+ * da busca em segundos (PrazoBusca.h), e com ele buscas 0 quer dizer
+ * "quantas couberem". O que a linha nao diz vem das opcoes da linha de
+ * comando; sem saida o nome do arquivo leva data, hora e a linha.
+ * Os pedidos "gera" do modo servidor usam a mesma linha (interpretaTrabalho).
+ */
+
+#ifndef TRABALHOSLOTE_H_
+#define TRABALHOSLOTE_H_
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include <stddef.h>
+
+struct TrabalhoRoda
+{
+	size_t r, t, m;          ///< dezenas do fechamento, por ticket e da garantia
+	size_t buscas;           ///< tentativas do guloso (qtdBusca)
+	size_t sobreposicao;     ///< permitirSobreposicao
+	size_t jogos;            ///< qtd_jogos
+	size_t universo;         ///< dezenas da loteria (--universo)
+	uint64_t semente;        ///< 0 = relogio
+	double tempo;            ///< prazo da busca em segundos; 0 = sem prazo
+	std::string filtros;
+	std::string saida;
+	size_t linha;            ///< linha do arquivo, para mensagens e nomes de saida
+
+	TrabalhoRoda()
+		: r(0), t(0), m(0), buscas(0), sobreposicao(1), jogos(0), universo(25), semente(0),
+		  tempo(0), filtros("padrao"), linha(0) {}
+
+	// Trabalhos com a mesma chave usam o mesmo grafo e a mesma roda
+	bool mesmaRoda(const TrabalhoRoda& outro) const {
+		return r == outro.r && t == outro.t && m == outro.m;
+	}
+};
+
+// Numero inteiro sem sinal ocupando o valor todo
+inline bool leNatural(const std::string& valor, uint64_t& numero)
+{
+	char* fim = NULL;
+	unsigned long long lido = strtoull(valor.c_str(), &fim, 10);
+	if (valor.empty() || valor[0] == '-' || valor[0] == '+' || *fim != '\0') return false;
+	numero = lido;
+	return true;
+}
+
+// Segundos (>= 0, com fracao) ocupando o valor todo
+inline bool leSegundos(const std::string& valor, double& segundos)
+{
+	char* fim = NULL;
+	double lido = strtod(valor.c_str(), &fim);
+	if (valor.empty() || *fim != '\0' || !(lido >= 0) || !std::isfinite(lido)) return false;
+	segundos = lido;
+	return true;
+}
+
+/**
+ * Le um trabalho da linha (sem comentario), por cima dos padroes que ja
+ * estiverem em 'trabalho'; devolve false com o motivo em 'erro'.
+ **/
+inline bool interpretaTrabalho(const std::string& linha, TrabalhoRoda& trabalho, std::string& erro)
+{
+	std::istringstream campos(linha);
+	if (!(campos >> trabalho.r >> trabalho.t >> trabalho.m >> trabalho.buscas >> trabalho.sobreposicao >> trabalho.jogos)) {
+		erro = "esperava r t m buscas sobreposicao jogos";
+		return false;
+	}
+	std::string opcao;
+	while (campos >> opcao) {
+		size_t igual = opcao.find('=');
+		std::string chave = opcao.substr(0, igual), valor = igual == std::string::npos ? "" : opcao.substr(igual + 1);
+		uint64_t numero = 0;
+		bool valido = true;
+		if (chave == "semente") {
+			valido = leNatural(valor, numero);
+			trabalho.semente = numero;
+		}
+		else if (chave == "filtros") trabalho.filtros = valor;
+		else if (chave == "saida") trabalho.saida = valor;
+		else if (chave == "universo") {
+			valido = leNatural(valor, numero) && numero <= SIZE_MAX;
+			trabalho.universo = static_cast<size_t>(numero);
+		}
+		else if (chave == "tempo") valido = leSegundos(valor, trabalho.tempo);
+		else {
+			erro = "opcao desconhecida " + opcao;
+			return false;
+		}
+		if (!valido) {
+			erro = "valor invalido em " + opcao;
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Le a lista de trabalhos. Devolve false, com a linha problematica em
+ * 'erro', se o arquivo nao abre ou alguma linha e invalida; 'padrao' da o
+ * que as linhas nao dizem.
+ **/
+inline bool carregaTrabalhos(const std::string& arquivo, const TrabalhoRoda& padrao,
+                             std::vector<TrabalhoRoda>& trabalhos, std::string& erro)
+{
+	std::ifstream entrada(arquivo.c_str());
+	if (!entrada) {
+		erro = "nao foi possivel abrir " + arquivo;
+		return false;
+	}
+	std::string linha;
+	for (size_t n = 1; std::getline(entrada, linha); ++n) {
+		size_t comentario = linha.find('#');
+		if (comentario != std::string::npos) linha.erase(comentario);
+		if (linha.find_first_not_of(" \t\r") == std::string::npos) continue;
+		TrabalhoRoda trabalho(padrao);
+		trabalho.linha = n;
+		if (!interpretaTrabalho(linha, trabalho, erro)) {
+			erro = arquivo + ":" + std::to_string(n) + ": " + erro;
+			return false;
+		}
+		trabalhos.push_back(trabalho);
+	}
+	return true;
+}
+
+/**
+ * Ordem de execucao: agrupa as linhas por (r, t, m), e dentro de cada r as
+ * de mesmo t ficam juntas, para que o grafo, as garantias e o universo de
+ * tickets sejam montados uma vez por grupo. Dentro do grupo vale a ordem do
+ * arquivo.
+ **/
+inline void ordenaTrabalhos(std::vector<TrabalhoRoda>& trabalhos)
+{
+	struct PorRoda {
+		bool operator()(const TrabalhoRoda& a, const TrabalhoRoda& b) const {
+			if (a.r != b.r) return a.r < b.r;
+			if (a.t != b.t) return a.t < b.t;
+			return a.m < b.m;
+		}
+	};
+	std::stable_sort(trabalhos.begin(), trabalhos.end(), PorRoda());
+}
+
+#endif /* TRABALHOSLOTE_H_ */
@@ -0,0 +1,55 @@
+/*
+ * UniversoTickets.h
+ *
+ * Todos os tickets de (R, T), na ordem de generateAllCombos, montados uma vez
+ * e compartilhados so para leitura. obtem() devolve o universo que alguem
+ * ainda estiver usando (o cache guarda so weak_ptr) ou monta um novo, entao a
+ * memoria e liberada quando o ultimo usuario solta o ponteiro e nunca ha duas
+ * copias do mesmo universo. Pode ser chamado de varias threads.
+ */
+
+#ifndef UNIVERSOTICKETS_H_
+#define UNIVERSOTICKETS_H_
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <boost/dynamic_bitset.hpp>
+#include "combinacao.h"
+#include "memoria.h"
+
+class UniversoTickets {
+public:
+	static std::shared_ptr<const UniversoTickets> obtem(size_t range, size_t ticket_size) {
+		static std::mutex trava;
+		static std::map<std::pair<size_t, size_t>, std::weak_ptr<const UniversoTickets> > cache;
+
+		std::lock_guard<std::mutex> guarda(trava);
+		std::weak_ptr<const UniversoTickets>& entrada = cache[std::make_pair(range, ticket_size)];
+		std::shared_ptr<const UniversoTickets> universo = entrada.lock();
+		if (!universo) {
+			universo.reset(new UniversoTickets(range, ticket_size));
+			entrada = universo;
+		}
+		return universo;
+	}
+
+	size_t range() const { return r; }
+	size_t ticketSize() const { return t; }
+	size_t tamanho() const { return todos.size(); }
+	const boost::dynamic_bitset<>& operator[](size_t i) const { return todos[i]; }
+	const std::vector<boost::dynamic_bitset<> >& tickets() const { return todos; }
+	size_t bytes() const { return memBytes(todos); }
+
+private:
+	size_t r, t;
+	std::vector<boost::dynamic_bitset<> > todos;
+
+	UniversoTickets(size_t range, size_t ticket_size) : r(range), t(ticket_size) {
+		boost::dynamic_bitset<> dezenas(range);
+		generateAllCombos(dezenas, 0, static_cast<int>(ticket_size), todos);
+	}
+};
+
+#endif /* UNIVERSOTICKETS_H_ */
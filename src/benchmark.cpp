@@ -0,0 +1,1008 @@
+/**
+ * Benchmark do gerador de rodas (RodaLoteriaBench)
+ *
+ * Mede cada etapa do programa principal em tamanhos fixos de problema
+ * (r/t/m), sem os system("pause") e sem depender de entrada interativa:
+ *
+ *   - enumeracao:   generateAllCombos e GeraCombIterarBitset
+ *   - grafo:        generateNodes
+ *   - atualizacao:  updatePotentials (uma chamada por ticket selecionado) e
+ *                   a versao original com pilha, updatePotentialsDFS
+ *   - selecao:      findBestCoverageTickets (varredura do argmax)
+ *   - guloso:       generateWheel completo, no modo padrao (motor
+ *                   automatico; MotorFixo em generateWheelFixo, quando o
+ *                   tamanho foi instanciado, e o motor generico em
+ *                   generateWheelGenerico), no preguicoso
+ *                   (generateWheelLazy), em lote (generateWheelLote) e
+ *                   com o grafo em disco (generateWheelDisco, em
+ *                   --dir-temp) e sem grafo (generateWheelImplicito);
+ *                   itens = tamanho da roda
+ *   - filtros:      remove15E14Num, eliminaMaiorGap, eliminaNumPosicao,
+ *                   eliminaNumSequencia
+ *   - entrada:      obter_resultados
+ *   - saida:        gravaApostasArquivo
+ *
+ * Uso:
+ *   RodaLoteriaBench [--tamanhos 17/15/14,18/15/14,20/15/14,25/15/11]
+ *                    [--repeticoes N] [--csv arquivo] [--json arquivo]
+ *                    [--baseline arquivo.csv] [--limite pct]
+ *                    [--max-arestas N] [--max-jogos N] [--sorteios N]
+ *                    [--dir-temp pasta] [--threads N] [--limiar-paralelo N]
+ *                    [--verifica]
+ *
+ * O CSV gerado pode ser usado depois como --baseline. Com --baseline, cada
+ * etapa cuja mediana ficar mais de --limite por cento acima da mediana
+ * gravada e reportada como regressao e o programa termina com codigo 1.
+ *
+ * Com --verifica, em vez de medir, roda o guloso completo em cada tamanho
+ * (por padrao 17/15/14 e 18/15/14) aplicando updatePotentials e
+ * updatePotentialsDFS a duas copias do grafo com as mesmas selecoes (com
+ * nos de 32 e de 64 bits), e confere que todos os nos ficam identicos apos
+ * cada passo; nos tamanhos com MotorFixo instanciado, confere o motor
+ * especializado da mesma forma, e confere que o grafo em disco (com shards
+ * pequenos, para passar pelo LRU) e o MotorImplicito tem as mesmas listas de
+ * generateNodes, e o MotorImplicito (e o MotorTroca, quando m = t - 1) as
+ * mesmas potencias a cada passo, que uma tentativa do MotorFixo cortada pelo
+ * prazo acaba vazia sem derrubar a seguinte, e que o IndiceHamming acha os mesmos
+ * vizinhos, o confereRoda conta os mesmos sorteios descobertos e o
+ * remove15E14Num remove os mesmos jogos que a comparacao de todos com todos. Com
+ * --threads e --limiar-paralelo 1 a conferencia passa pelo caminho paralelo.
+ **/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <boost/dynamic_bitset.hpp>
+#include "wheelgen.h"
+#include "MotorFixo.h"
+#include "MascaraDezenas.h"
+#include "GrafoEmDisco.h"
+#include "MotorImplicito.h"
+#include "MotorTroca.h"
+#include "IndiceHamming.h"
+#include "BibliotecaRodas.h"
+#include "PrazoBusca.h"
+#include "UniversoTickets.h"
+#include "combinacao.h"
+#include "GeraCombIterarBitSet.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::map;
+using std::unique_ptr;
+
+// Resultado de uma etapa medida em um tamanho de problema
+struct Medida
+{
+  string tamanho;
+  string etapa;
+  size_t repeticoes;
+  double min_ns;
+  double mediana_ns;
+  double media_ns;
+  uint64_t itens;
+};
+
+// Descarta tudo que e escrito em cout enquanto estiver vivo; generateNodes e
+// generateWheel imprimem progresso que so atrapalharia a medicao
+class SilenciaSaida
+{
+  struct BufferNulo : public std::streambuf {
+    int overflow(int c) { return c; }
+  };
+  BufferNulo nulo;
+  std::streambuf* anterior;
+public:
+  SilenciaSaida() : anterior(cout.rdbuf(&nulo)) {}
+  ~SilenciaSaida() { cout.rdbuf(anterior); }
+};
+
+static size_t repeticoes = 3;
+static uint64_t max_arestas = 20000000;
+static size_t max_jogos = 5000;
+static size_t qtd_sorteios = 1000;
+static string dir_temp = ".";
+
+/**
+ * Executa prepara() e depois executa() 'repeticoes' vezes, medindo apenas
+ * executa(). executa() devolve a quantidade de itens processados, usada so
+ * para conferencia no relatorio.
+ **/
+template <class Prepara, class Executa>
+static Medida mede(const string& tamanho, const string& etapa,
+                   Prepara prepara, Executa executa)
+{
+  vector<double> tempos;
+  uint64_t itens = 0;
+
+  for (size_t i = 0; i < repeticoes; ++i) {
+    SilenciaSaida silencio;
+    prepara();
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    itens = executa();
+    std::chrono::steady_clock::time_point fim = std::chrono::steady_clock::now();
+    tempos.push_back(std::chrono::duration<double, std::nano>(fim - inicio).count());
+  }
+
+  std::sort(tempos.begin(), tempos.end());
+  double soma = 0;
+  for (size_t i = 0; i < tempos.size(); ++i) soma += tempos[i];
+
+  Medida m;
+  m.tamanho = tamanho;
+  m.etapa = etapa;
+  m.repeticoes = tempos.size();
+  m.min_ns = tempos.front();
+  m.mediana_ns = tempos[tempos.size() / 2];
+  m.media_ns = soma / tempos.size();
+  m.itens = itens;
+
+  cout << std::left;
+  cout.width(10); cout << tamanho;
+  cout.width(28); cout << etapa;
+  cout << std::right;
+  cout.width(16); cout << static_cast<uint64_t>(m.mediana_ns) << " ns";
+  cout.width(12); cout << itens << " itens" << endl;
+
+  return m;
+}
+
+static void preparaUniverso(vector<boost::dynamic_bitset<> >& all_tickets,
+                            vector<boost::dynamic_bitset<> >& todas_garantias)
+{
+  boost::dynamic_bitset<> dezenas(qtd_dezenas_jogo);
+
+  all_tickets.clear();
+  todas_garantias.clear();
+  generateAllCombos(dezenas, 0, qtd_dezenas_sorteio, all_tickets);
+  dezenas.reset();
+  generateAllCombos(dezenas, 0, qtd_dez_garante_acertos, todas_garantias);
+}
+
+// Converte os tickets enumerados para jogos com dezenas de 1 a r, como os
+// filtros recebem no programa principal
+static void preparaJogos(vector<vector<int> >& jogos)
+{
+  vector<boost::dynamic_bitset<> > tickets;
+  boost::dynamic_bitset<> dezenas(qtd_dezenas_jogo);
+  generateAllCombos(dezenas, 0, qtd_dezenas_sorteio, tickets);
+
+  size_t passo = std::max<size_t>(tickets.size() / max_jogos, 1);
+  jogos.clear();
+  for (size_t i = 0; i < tickets.size() && jogos.size() < max_jogos; i += passo) {
+    vector<int> jogo;
+    size_t pos = tickets[i].find_first();
+    while (pos != boost::dynamic_bitset<>::npos) {
+      jogo.push_back(pos + 1);
+      pos = tickets[i].find_next(pos);
+    }
+    jogos.push_back(jogo);
+  }
+}
+
+// Gera um arquivo no formato de resultados.csv (seq;data;n1..n15) com
+// sorteios aleatorios de 15 dezenas entre 25
+static void escreveResultadosSinteticos(const string& arquivo, size_t qtd)
+{
+  std::mt19937_64 eng(12345);
+  std::ofstream out(arquivo.c_str());
+  vector<int> dezenas;
+  for (int d = 1; d <= 25; ++d) dezenas.push_back(d);
+
+  out << "seq;data;n1;n2;n3;n4;n5;n6;n7;n8;n9;n10;n11;n12;n13;n14;n15" << endl;
+  for (size_t i = 0; i < qtd; ++i) {
+    std::shuffle(dezenas.begin(), dezenas.end(), eng);
+    vector<int> sorteio(dezenas.begin(), dezenas.begin() + 15);
+    std::sort(sorteio.begin(), sorteio.end());
+    out << i + 1 << ";01/01/2000";
+    for (size_t j = 0; j < sorteio.size(); ++j) out << ";" << sorteio[j];
+    out << endl;
+  }
+}
+
+static void medeTamanho(const string& tamanho, vector<Medida>& medidas)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  vector<TicketNode> ticket_nodes;
+  vector<MatchNode> garantias_nodes;
+  vector<TicketNode> ticket_nodes_base;
+  vector<MatchNode> garantias_nodes_base;
+
+  uint64_t qtd_tickets = comb(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+  uint64_t arestas = qtd_tickets * comb(qtd_dezenas_sorteio, qtd_dez_garante_acertos);
+
+  medidas.push_back(mede(tamanho, "generateAllCombos",
+    [&]() { all_tickets.clear(); },
+    [&]() {
+      boost::dynamic_bitset<> dezenas(qtd_dezenas_jogo);
+      generateAllCombos(dezenas, 0, qtd_dezenas_sorteio, all_tickets);
+      return static_cast<uint64_t>(all_tickets.size());
+    }));
+  all_tickets.clear();
+  all_tickets.shrink_to_fit();
+
+  medidas.push_back(mede(tamanho, "GeraCombIterarBitset",
+    [&]() {},
+    [&]() {
+      GeraCombIterarBitset gera(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+      uint64_t qtd = 0;
+      while (gera.hasNext()) {
+        qtd += gera.next().count() != 0;
+      }
+      return qtd;
+    }));
+
+  if (arestas > max_arestas) {
+    cerr << tamanho << ": grafo com " << arestas << " arestas excede --max-arestas ("
+         << max_arestas << "), etapas do grafo puladas." << endl;
+  } else {
+    medidas.push_back(mede(tamanho, "generateNodes",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        ticket_nodes.clear();
+        garantias_nodes.clear();
+      },
+      [&]() {
+        generateNodes(all_tickets, todas_garantias, ticket_nodes, garantias_nodes);
+        return static_cast<uint64_t>(ticket_nodes.size());
+      }));
+    ticket_nodes_base = ticket_nodes;
+    garantias_nodes_base = garantias_nodes;
+
+    // Sequencia fixa de selecoes, na mesma forma que o guloso faz: o ticket e
+    // marcado coberto, zerado e entao os potenciais sao atualizados
+    vector<uint64_t> selecionados;
+    std::mt19937_64 eng(42);
+    std::uniform_int_distribution<uint64_t> distr(0, ticket_nodes_base.size() - 1);
+    for (size_t i = 0; i < std::min<size_t>(64, ticket_nodes_base.size()); ++i)
+      selecionados.push_back(distr(eng));
+
+    medidas.push_back(mede(tamanho, "updatePotentials",
+      [&]() { ticket_nodes = ticket_nodes_base; garantias_nodes = garantias_nodes_base; },
+      [&]() {
+        for (size_t i = 0; i < selecionados.size(); ++i) {
+          ticket_nodes[selecionados[i]].remaining_coverage = 0;
+          ticket_nodes[selecionados[i]].is_covered = 1;
+          updatePotentials(ticket_nodes, garantias_nodes, selecionados[i]);
+        }
+        return static_cast<uint64_t>(selecionados.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "updatePotentialsDFS",
+      [&]() { ticket_nodes = ticket_nodes_base; garantias_nodes = garantias_nodes_base; },
+      [&]() {
+        for (size_t i = 0; i < selecionados.size(); ++i) {
+          ticket_nodes[selecionados[i]].remaining_coverage = 0;
+          ticket_nodes[selecionados[i]].is_covered = 1;
+          updatePotentialsDFS(ticket_nodes, garantias_nodes, selecionados[i]);
+        }
+        return static_cast<uint64_t>(selecionados.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "findBestCoverageTickets",
+      [&]() {},
+      [&]() {
+        vector<uint64_t> best_coverage_ticket_idxs;
+        findBestCoverageTickets(ticket_nodes, best_coverage_ticket_idxs);
+        return static_cast<uint64_t>(best_coverage_ticket_idxs.size());
+      }));
+
+    ticket_nodes.clear();
+    garantias_nodes.clear();
+    ticket_nodes_base.clear();
+    garantias_nodes_base.clear();
+
+    // Segura o universo de tickets, que generateWheel so reaproveita (fora da medicao)
+    std::shared_ptr<const UniversoTickets> universo = UniversoTickets::obtem(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+
+    medidas.push_back(mede(tamanho, "generateWheel",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        limpaCopiasNos();
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "generateWheelLazy",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        limpaCopiasNos();
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        modoGuloso = GULOSO_PREGUICOSO;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        modoGuloso = GULOSO_PADRAO;
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "generateWheelFixo",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        limpaCopiasNos();
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        motorGuloso = MOTOR_FIXO;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        motorGuloso = MOTOR_AUTOMATICO;
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "generateWheelGenerico",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        limpaCopiasNos();
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        motorGuloso = MOTOR_GENERICO;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        motorGuloso = MOTOR_AUTOMATICO;
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "generateWheelLote",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        limpaCopiasNos();
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        modoGuloso = GULOSO_LOTE;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        modoGuloso = GULOSO_PADRAO;
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+
+    medidas.push_back(mede(tamanho, "generateWheelDisco",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        limpaCopiasNos();
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        dirGrafoDisco = dir_temp;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        dirGrafoDisco.clear();
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+    limpaCopiasNos();
+
+    medidas.push_back(mede(tamanho, "generateWheelImplicito",
+      [&]() {
+        preparaUniverso(all_tickets, todas_garantias);
+        menorAposta = qtd_tickets;
+      },
+      [&]() {
+        vector<uint64_t> wheel_ticket_idxs;
+        motorGuloso = MOTOR_IMPLICITO;
+        generateWheel(todas_garantias, wheel_ticket_idxs);
+        motorGuloso = MOTOR_AUTOMATICO;
+        return static_cast<uint64_t>(wheel_ticket_idxs.size());
+      }));
+    all_tickets.clear();
+    all_tickets.shrink_to_fit();
+    todas_garantias.clear();
+    todas_garantias.shrink_to_fit();
+  }
+
+  vector<vector<int> > jogos_base;
+  vector<vector<int> > jogos;
+  preparaJogos(jogos_base);
+
+  string arquivo_resultados = dir_temp + "/bench_resultados.csv";
+  escreveResultadosSinteticos(arquivo_resultados, qtd_sorteios);
+  vector<vector<int> > resultados;
+
+  medidas.push_back(mede(tamanho, "obter_resultados",
+    [&]() {},
+    [&]() {
+      resultados = obter_resultados(arquivo_resultados);
+      return static_cast<uint64_t>(resultados.size());
+    }));
+  std::remove(arquivo_resultados.c_str());
+
+  medidas.push_back(mede(tamanho, "remove15E14Num",
+    [&]() { jogos = jogos_base; },
+    [&]() { remove15E14Num(resultados, jogos); return static_cast<uint64_t>(jogos.size()); }));
+
+  medidas.push_back(mede(tamanho, "eliminaMaiorGap",
+    [&]() { jogos = jogos_base; },
+    [&]() { eliminaMaiorGap(5, jogos); return static_cast<uint64_t>(jogos.size()); }));
+
+  medidas.push_back(mede(tamanho, "eliminaNumPosicao",
+    [&]() { jogos = jogos_base; },
+    [&]() { eliminaNumPosicao(jogos); return static_cast<uint64_t>(jogos.size()); }));
+
+  medidas.push_back(mede(tamanho, "eliminaNumSequencia",
+    [&]() { jogos = jogos_base; },
+    [&]() { eliminaNumSequencia(8, jogos); return static_cast<uint64_t>(jogos.size()); }));
+
+  string arquivo_apostas = dir_temp + "/bench_apostas.txt";
+  medidas.push_back(mede(tamanho, "gravaApostasArquivo",
+    [&]() {},
+    [&]() {
+      gravaApostasArquivo(jogos_base, arquivo_apostas);
+      return static_cast<uint64_t>(jogos_base.size());
+    }));
+  std::remove(arquivo_apostas.c_str());
+}
+
+/**
+ * Roda o guloso ate o fim com as duas versoes de updatePotentials sobre copias
+ * do mesmo grafo, escolhendo sempre o mesmo ticket nas duas, e compara os nos
+ * depois de cada selecao. Devolve false na primeira diferenca.
+ **/
+template <class Indice>
+static bool verificaKernel(const string& tamanho)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  vector<TicketNodeT<Indice> > nodes_a, nodes_b;
+  vector<MatchNodeT<Indice> > garantias_a;
+
+  {
+    SilenciaSaida silencio;
+    preparaUniverso(all_tickets, todas_garantias);
+    generateNodes(all_tickets, todas_garantias, nodes_a, garantias_a);
+  }
+  nodes_b = nodes_a;
+  vector<MatchNodeT<Indice> > garantias_b = garantias_a;
+
+  std::mt19937_64 eng(2024);
+  uint64_t start_ticket_idx = std::uniform_int_distribution<uint64_t>(0, nodes_a.size() - 1)(eng);
+  size_t passos = 0;
+
+  while (true) {
+    nodes_a[start_ticket_idx].remaining_coverage = 0;
+    nodes_a[start_ticket_idx].is_covered = 1;
+    nodes_b[start_ticket_idx].remaining_coverage = 0;
+    nodes_b[start_ticket_idx].is_covered = 1;
+    updatePotentials(nodes_a, garantias_a, start_ticket_idx);
+    updatePotentialsDFS(nodes_b, garantias_b, start_ticket_idx);
+    ++passos;
+
+    for (size_t i = 0; i < nodes_a.size(); ++i) {
+      if (nodes_a[i].is_covered != nodes_b[i].is_covered ||
+          nodes_a[i].remaining_coverage != nodes_b[i].remaining_coverage) {
+        cout << tamanho << " (" << sizeof(Indice) * 8 << " bits): DIFERENCA no ticket " << i << " apos " << passos << " selecoes ("
+             << nodes_a[i].remaining_coverage << " x " << nodes_b[i].remaining_coverage << ")" << endl;
+        return false;
+      }
+    }
+
+    vector<uint64_t> best_coverage_ticket_idxs;
+    if (findBestCoverageTickets(nodes_a, best_coverage_ticket_idxs) == 0) break;
+    start_ticket_idx = best_coverage_ticket_idxs[
+      std::uniform_int_distribution<size_t>(0, best_coverage_ticket_idxs.size() - 1)(eng)];
+  }
+
+  cout << tamanho << " (" << sizeof(Indice) * 8 << " bits): identicos em " << passos << " selecoes" << endl;
+  return true;
+}
+
+/**
+ * Mesma comparacao entre updatePotentials e o MotorFixo da configuracao,
+ * quando ela foi instanciada (com o pool de --threads, se houver).
+ **/
+struct VerificaMotorFixo
+{
+  string tamanho;
+  bool ok;
+
+  template <unsigned R, unsigned T, unsigned M>
+  void executa()
+  {
+    vector<boost::dynamic_bitset<> > all_tickets;
+    vector<boost::dynamic_bitset<> > todas_garantias;
+    vector<TicketNode> nodes;
+    vector<MatchNode> garantias;
+
+    {
+      SilenciaSaida silencio;
+      preparaUniverso(all_tickets, todas_garantias);
+      generateNodes(all_tickets, todas_garantias, nodes, garantias);
+    }
+    MotorFixo<R, T, M> motor(nodes, garantias);
+    unique_ptr<PoolThreads> pool(qtdThreads > 1 ? new PoolThreads(qtdThreads) : NULL);
+
+    std::mt19937_64 eng(2024);
+    uint64_t start_ticket_idx = std::uniform_int_distribution<uint64_t>(0, nodes.size() - 1)(eng);
+    size_t passos = 0;
+
+    while (true) {
+      nodes[start_ticket_idx].remaining_coverage = 0;
+      nodes[start_ticket_idx].is_covered = 1;
+      updatePotentials(nodes, garantias, start_ticket_idx);
+      motor.seleciona(start_ticket_idx, pool.get(), limiarParalelo);
+      ++passos;
+
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        if (static_cast<bool>(nodes[i].is_covered) != motor.coberto(i) ||
+            nodes[i].remaining_coverage != motor.cobertura(i)) {
+          cout << tamanho << ": DIFERENCA no MotorFixo, ticket " << i << " apos " << passos << " selecoes" << endl;
+          ok = false;
+          return;
+        }
+      }
+
+      vector<uint64_t> best_coverage_ticket_idxs;
+      if (findBestCoverageTickets(nodes, best_coverage_ticket_idxs) == 0) break;
+      start_ticket_idx = best_coverage_ticket_idxs[
+        std::uniform_int_distribution<size_t>(0, best_coverage_ticket_idxs.size() - 1)(eng)];
+    }
+
+    cout << tamanho << ": MotorFixo identico em " << passos << " selecoes" << endl;
+  }
+};
+
+/**
+ * Corta uma tentativa do MotorFixo logo no comeco, como faz --tempo: a
+ * tentativa tem que acabar vazia no proprio motor, sem cair no laco generico
+ * com os nos ja consumidos, e a seguinte (sem prazo) tem que fechar a roda a
+ * partir das copias dos nos.
+ **/
+static bool verificaCorteFixo(const string& tamanho)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  vector<uint64_t> cortada, inteira;
+
+  {
+    SilenciaSaida silencio;
+    preparaUniverso(all_tickets, todas_garantias);
+    limpaCopiasNos();
+    menorAposta = comb(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+    qtdBusca = 2;
+    motorGuloso = MOTOR_FIXO;
+    PrazoBusca::inicia(1e-9);
+    PrazoBusca::permiteCorte(true);
+    PrazoBusca::acabou();   // le o relogio ja, para o corte vir na primeira consulta
+    generateWheel(todas_garantias, cortada);
+    PrazoBusca::inicia(0);
+    generateWheel(todas_garantias, inteira);
+    motorGuloso = MOTOR_AUTOMATICO;
+    qtdBusca = 1;
+    limpaCopiasNos();
+  }
+
+  if (!cortada.empty() || inteira.empty()) {
+    cout << tamanho << ": DIFERENCA no corte do MotorFixo (" << cortada.size() << " cortada, "
+         << inteira.size() << " inteira)" << endl;
+    return false;
+  }
+  cout << tamanho << ": MotorFixo cortado pelo prazo, roda seguinte com " << inteira.size() << " jogos" << endl;
+  return true;
+}
+
+/**
+ * Monta o grafo em disco com shards de 4 KB e cache de tres shards e compara
+ * cada lista de adjacencia com a do grafo de generateNodes.
+ **/
+template <class Indice>
+static bool verificaGrafoDisco(const string& tamanho)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  vector<TicketNodeT<Indice> > nodes;
+  vector<MatchNodeT<Indice> > garantias;
+
+  {
+    SilenciaSaida silencio;
+    preparaUniverso(all_tickets, todas_garantias);
+    generateNodes(all_tickets, todas_garantias, nodes, garantias);
+  }
+  GrafoEmDisco<Indice> grafo(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos,
+                             dir_temp, 3 * 4096, 4096);
+  if (!grafo.constroi()) {
+    cout << tamanho << ": nao foi possivel gravar o grafo em " << dir_temp << endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const Indice* lista = grafo.garantiasDoTicket(i);
+    if (!lista || !std::equal(nodes[i].match_indexes.begin(), nodes[i].match_indexes.end(), lista)) {
+      cout << tamanho << ": DIFERENCA no grafo em disco, ticket " << i << endl;
+      return false;
+    }
+  }
+  for (size_t i = 0; i < garantias.size(); ++i) {
+    const Indice* lista = grafo.ticketsDaGarantia(i);
+    if (!lista || !std::equal(garantias[i].ticket_indexes.begin(), garantias[i].ticket_indexes.end(), lista)) {
+      cout << tamanho << ": DIFERENCA no grafo em disco, garantia " << i << endl;
+      return false;
+    }
+  }
+
+  cout << tamanho << ": grafo em disco identico (" << grafo.shardsLidos() << " shards lidos)" << endl;
+  return true;
+}
+
+/**
+ * Confere as listas geradas pelo MotorImplicito contra as de generateNodes e
+ * depois roda o guloso comparando as potencias com as de updatePotentials.
+ **/
+template <class Indice>
+static bool verificaImplicito(const string& tamanho)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  vector<TicketNodeT<Indice> > nodes;
+  vector<MatchNodeT<Indice> > garantias;
+
+  {
+    SilenciaSaida silencio;
+    preparaUniverso(all_tickets, todas_garantias);
+    generateNodes(all_tickets, todas_garantias, nodes, garantias);
+  }
+  MotorImplicito<Indice> motor(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos);
+
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (motor.garantiasDoTicket(i) != nodes[i].match_indexes) {
+      cout << tamanho << ": DIFERENCA nas garantias implicitas do ticket " << i << endl;
+      return false;
+    }
+  }
+  for (size_t i = 0; i < garantias.size(); ++i) {
+    if (motor.ticketsDaGarantia(i) != garantias[i].ticket_indexes) {
+      cout << tamanho << ": DIFERENCA nos tickets implicitos da garantia " << i << endl;
+      return false;
+    }
+  }
+
+  std::mt19937_64 eng(2024);
+  uint64_t start_ticket_idx = std::uniform_int_distribution<uint64_t>(0, nodes.size() - 1)(eng);
+  size_t passos = 0;
+
+  while (true) {
+    nodes[start_ticket_idx].remaining_coverage = 0;
+    nodes[start_ticket_idx].is_covered = 1;
+    updatePotentials(nodes, garantias, start_ticket_idx);
+    motor.seleciona(start_ticket_idx, NULL, 0);
+    ++passos;
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (static_cast<bool>(nodes[i].is_covered) != motor.coberto(i) ||
+          nodes[i].remaining_coverage != motor.cobertura(i)) {
+        cout << tamanho << ": DIFERENCA no MotorImplicito, ticket " << i << " apos " << passos << " selecoes" << endl;
+        return false;
+      }
+    }
+
+    vector<uint64_t> best_coverage_ticket_idxs;
+    if (findBestCoverageTickets(nodes, best_coverage_ticket_idxs) == 0) break;
+    start_ticket_idx = best_coverage_ticket_idxs[
+      std::uniform_int_distribution<size_t>(0, best_coverage_ticket_idxs.size() - 1)(eng)];
+  }
+
+  cout << tamanho << ": MotorImplicito identico em " << passos << " selecoes" << endl;
+  return true;
+}
+
+// Mesma comparacao para o MotorTroca (m = t - 1), com o pool de --threads
+template <class Indice>
+static bool verificaTroca(const string& tamanho)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  vector<TicketNodeT<Indice> > nodes;
+  vector<MatchNodeT<Indice> > garantias;
+
+  {
+    SilenciaSaida silencio;
+    preparaUniverso(all_tickets, todas_garantias);
+    generateNodes(all_tickets, todas_garantias, nodes, garantias);
+  }
+  MotorTroca<Indice> motor(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+  unique_ptr<PoolThreads> pool(qtdThreads > 1 ? new PoolThreads(qtdThreads) : NULL);
+
+  // As garantias de cada ticket, pela sobreposicao
+  vector<bool> usada(garantias.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    motor.marcaGarantias(i, usada);
+    for (size_t g = 0; g < usada.size(); ++g) {
+      bool esperado = std::find(nodes[i].match_indexes.begin(), nodes[i].match_indexes.end(), g) !=
+                      nodes[i].match_indexes.end();
+      if (usada[g] != esperado) {
+        cout << tamanho << ": DIFERENCA nas garantias do MotorTroca, ticket " << i << endl;
+        return false;
+      }
+    }
+    std::fill(usada.begin(), usada.end(), false);
+  }
+
+  std::mt19937_64 eng(2024);
+  uint64_t start_ticket_idx = std::uniform_int_distribution<uint64_t>(0, nodes.size() - 1)(eng);
+  size_t passos = 0;
+
+  while (true) {
+    nodes[start_ticket_idx].remaining_coverage = 0;
+    nodes[start_ticket_idx].is_covered = 1;
+    updatePotentials(nodes, garantias, start_ticket_idx);
+    motor.seleciona(start_ticket_idx, pool.get(), limiarParalelo);
+    ++passos;
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (static_cast<bool>(nodes[i].is_covered) != motor.coberto(i) ||
+          nodes[i].remaining_coverage != motor.cobertura(i)) {
+        cout << tamanho << ": DIFERENCA no MotorTroca, ticket " << i << " apos " << passos << " selecoes" << endl;
+        return false;
+      }
+    }
+
+    vector<uint64_t> best_coverage_ticket_idxs;
+    if (findBestCoverageTickets(nodes, best_coverage_ticket_idxs) == 0) break;
+    start_ticket_idx = best_coverage_ticket_idxs[
+      std::uniform_int_distribution<size_t>(0, best_coverage_ticket_idxs.size() - 1)(eng)];
+  }
+
+  cout << tamanho << ": MotorTroca identico em " << passos << " selecoes" << endl;
+  return true;
+}
+
+/**
+ * Confere o IndiceHamming contra a comparacao de todos com todos: os vizinhos
+ * de raio 2 (t - m) e a contagem de quem divide exatamente m dezenas, para
+ * uma amostra de tickets, o confereRoda numa roda de amostra, e o
+ * remove15E14Num com resultados sorteados entre os proprios jogos e jogos com
+ * uma dezena trocada.
+ **/
+template <class M>
+static bool verificaIndiceHamming(const string& tamanho)
+{
+  vector<boost::dynamic_bitset<> > all_tickets;
+  vector<boost::dynamic_bitset<> > todas_garantias;
+  preparaUniverso(all_tickets, todas_garantias);
+
+  size_t raio = 2 * (qtd_dezenas_sorteio - qtd_dez_garante_acertos);
+  IndiceHamming<M> indice(qtd_dezenas_jogo, raio + 1);
+  indexaTickets(indice, all_tickets);
+
+  size_t passo = std::max<size_t>(all_tickets.size() / 200, 1);
+  for (size_t i = 0; i < all_tickets.size(); i += passo) {
+    vector<bool> achou(all_tickets.size(), false);
+    indice.vizinhos(indice.mascara(i), raio, [&](uint32_t id, unsigned) { achou[id] = true; });
+    uint64_t comuns = 0;
+    for (size_t j = 0; j < all_tickets.size(); ++j) {
+      size_t c = (all_tickets[i] & all_tickets[j]).count();
+      if (c == qtd_dez_garante_acertos) ++comuns;
+      if (achou[j] != (c >= qtd_dez_garante_acertos)) {
+        cout << tamanho << ": DIFERENCA nos vizinhos do IndiceHamming, tickets " << i << " e " << j << endl;
+        return false;
+      }
+    }
+    if (indice.contaComuns(indice.mascara(i), qtd_dez_garante_acertos, vector<bool>()) != comuns) {
+      cout << tamanho << ": DIFERENCA na contagem do IndiceHamming, ticket " << i << endl;
+      return false;
+    }
+  }
+
+  // confereRoda, que consulta o indice, contra a conta direta numa roda de amostra
+  BibliotecaRodas::Roda roda;
+  vector<size_t> amostra;
+  for (size_t i = 0; i < all_tickets.size(); i += 3 * passo + 1) {
+    amostra.push_back(i);
+    roda.push_back(vector<int>());
+    for (size_t d = all_tickets[i].find_first(); d != boost::dynamic_bitset<>::npos; d = all_tickets[i].find_next(d))
+      roda.back().push_back(static_cast<int>(d + 1));
+  }
+  uint64_t descobertos = 0;
+  for (size_t j = 0; j < all_tickets.size(); ++j) {
+    size_t k = 0;
+    while (k < amostra.size() && (all_tickets[j] & all_tickets[amostra[k]]).count() < qtd_dez_garante_acertos) ++k;
+    if (k == amostra.size()) ++descobertos;
+  }
+  if (confereRoda(roda, qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos) != descobertos) {
+    cout << tamanho << ": DIFERENCA no confereRoda (esperado " << descobertos << " descobertos)" << endl;
+    return false;
+  }
+
+  vector<vector<int> > jogos;
+  preparaJogos(jogos);
+  vector<vector<int> > resultados;
+  std::mt19937_64 eng(2024);
+  for (size_t i = 0; i < jogos.size(); i += 7) {
+    vector<int> resultado = jogos[i];
+    if (i % 2) resultado[eng() % resultado.size()] = static_cast<int>(qtd_dezenas_jogo + 1 + eng() % 3);
+    std::sort(resultado.begin(), resultado.end());
+    resultados.push_back(resultado);
+  }
+  vector<vector<int> > esperado;
+  for (size_t j = 0; j < jogos.size(); ++j) {
+    bool remove = false;
+    for (size_t i = 0; i < resultados.size() && !remove; ++i) {
+      vector<int> intersecao;
+      std::set_intersection(resultados[i].begin(), resultados[i].end(), jogos[j].begin(), jogos[j].end(),
+                            std::back_inserter(intersecao));
+      remove = resultados[i] == jogos[j] || intersecao.size() == 14;
+    }
+    if (!remove) esperado.push_back(jogos[j]);
+  }
+  remove15E14Num(resultados, jogos);
+  if (jogos != esperado) {
+    cout << tamanho << ": DIFERENCA no remove15E14Num (" << jogos.size() << " jogos, esperado "
+         << esperado.size() << ")" << endl;
+    return false;
+  }
+
+  cout << tamanho << ": IndiceHamming identico (" << esperado.size() << " jogos restantes)" << endl;
+  return true;
+}
+
+static void gravaCsv(const vector<Medida>& medidas, const string& arquivo)
+{
+  std::ofstream out(arquivo.c_str());
+  out << "tamanho,etapa,repeticoes,min_ns,mediana_ns,media_ns,itens" << endl;
+  for (size_t i = 0; i < medidas.size(); ++i) {
+    const Medida& m = medidas[i];
+    out << m.tamanho << "," << m.etapa << "," << m.repeticoes << ","
+        << static_cast<uint64_t>(m.min_ns) << "," << static_cast<uint64_t>(m.mediana_ns) << ","
+        << static_cast<uint64_t>(m.media_ns) << "," << m.itens << endl;
+  }
+}
+
+static void gravaJson(const vector<Medida>& medidas, const string& arquivo)
+{
+  std::ofstream out(arquivo.c_str());
+  out << "[" << endl;
+  for (size_t i = 0; i < medidas.size(); ++i) {
+    const Medida& m = medidas[i];
+    out << "  {\"tamanho\": \"" << m.tamanho << "\", \"etapa\": \"" << m.etapa
+        << "\", \"repeticoes\": " << m.repeticoes
+        << ", \"min_ns\": " << static_cast<uint64_t>(m.min_ns)
+        << ", \"mediana_ns\": " << static_cast<uint64_t>(m.mediana_ns)
+        << ", \"media_ns\": " << static_cast<uint64_t>(m.media_ns)
+        << ", \"itens\": " << m.itens << "}"
+        << (i + 1 < medidas.size() ? "," : "") << endl;
+  }
+  out << "]" << endl;
+}
+
+/**
+ * Compara as medianas com as de um CSV gravado anteriormente por --csv.
+ * Devolve a quantidade de etapas que ficaram mais lentas que o limite.
+ **/
+static size_t comparaBaseline(const vector<Medida>& medidas, const string& arquivo, double limite_pct)
+{
+  std::ifstream in(arquivo.c_str());
+  if (!in) {
+    cerr << "Nao foi possivel abrir o baseline " << arquivo << endl;
+    return 1;
+  }
+
+  map<string, double> base;
+  string linha;
+  std::getline(in, linha);
+  while (std::getline(in, linha)) {
+    std::stringstream ss(linha);
+    vector<string> campos;
+    string campo;
+    while (std::getline(ss, campo, ',')) campos.push_back(campo);
+    if (campos.size() < 5) continue;
+    base[campos[0] + "," + campos[1]] = atof(campos[4].c_str());
+  }
+
+  size_t regressoes = 0;
+  cout << endl << "Comparacao com " << arquivo << " (limite " << limite_pct << "%):" << endl;
+  for (size_t i = 0; i < medidas.size(); ++i) {
+    const Medida& m = medidas[i];
+    map<string, double>::const_iterator b = base.find(m.tamanho + "," + m.etapa);
+    if (b == base.end() || b->second <= 0) continue;
+
+    double variacao = 100.0 * (m.mediana_ns - b->second) / b->second;
+    bool regressao = variacao > limite_pct;
+    if (regressao) ++regressoes;
+
+    cout << std::left;
+    cout.width(10); cout << m.tamanho;
+    cout.width(28); cout << m.etapa;
+    cout << std::right;
+    cout.width(10); cout << std::fixed;
+    cout.precision(1); cout << variacao << "%" << (regressao ? "  REGRESSAO" : "") << endl;
+  }
+
+  return regressoes;
+}
+
+int main(int argc, char *argv[])
+{
+  vector<string> tamanhos;
+  string arquivo_csv, arquivo_json, arquivo_baseline;
+  double limite_pct = 10.0;
+  string lista_tamanhos = "17/15/14,18/15/14,20/15/14,25/15/11";
+  bool verifica = false;
+
+  for (int i = 1; i < argc; ++i) {
+    string opcao = argv[i];
+    if (opcao == "--verifica") {
+      verifica = true;
+      lista_tamanhos = "17/15/14,18/15/14";
+      continue;
+    }
+    if (i + 1 >= argc) {
+      cerr << "Opcao sem valor: " << opcao << endl;
+      return 2;
+    }
+    string valor = argv[++i];
+    if (opcao == "--tamanhos") lista_tamanhos = valor;
+    else if (opcao == "--repeticoes") repeticoes = std::max(atoi(valor.c_str()), 1);
+    else if (opcao == "--csv") arquivo_csv = valor;
+    else if (opcao == "--json") arquivo_json = valor;
+    else if (opcao == "--baseline") arquivo_baseline = valor;
+    else if (opcao == "--limite") limite_pct = atof(valor.c_str());
+    else if (opcao == "--max-arestas") max_arestas = strtoull(valor.c_str(), NULL, 10);
+    else if (opcao == "--max-jogos") max_jogos = std::max(atoi(valor.c_str()), 1);
+    else if (opcao == "--sorteios") qtd_sorteios = atoi(valor.c_str());
+    else if (opcao == "--dir-temp") dir_temp = valor;
+    else if (opcao == "--threads") qtdThreads = std::max(atoi(valor.c_str()), 1);
+    else if (opcao == "--limiar-paralelo") limiarParalelo = strtoull(valor.c_str(), NULL, 10);
+    else {
+      cerr << "Opcao desconhecida: " << opcao << endl;
+      return 2;
+    }
+  }
+
+  std::stringstream ss(lista_tamanhos);
+  string tamanho;
+  while (std::getline(ss, tamanho, ',')) tamanhos.push_back(tamanho);
+
+  // Sem sobreposicao restrita e sem corte por menorAposta, para que cada
+  // execucao do guloso faca sempre o trabalho completo
+  qtdBusca = 1;
+  permitirSobreposicao = 1;
+
+  vector<Medida> medidas;
+  for (size_t i = 0; i < tamanhos.size(); ++i) {
+    unsigned r = 0, t = 0, m = 0;
+    if (sscanf(tamanhos[i].c_str(), "%u/%u/%u", &r, &t, &m) != 3 || m > t || t > r || r > MASCARA_MAX_DEZENAS) {
+      cerr << "Tamanho invalido: " << tamanhos[i] << " (use r/t/m)" << endl;
+      return 2;
+    }
+    qtd_dezenas_jogo = r;
+    qtd_dezenas_sorteio = t;
+    qtd_dez_garante_acertos = m;
+    limpaCopiasNos();
+
+    if (verifica) {
+      if (!verificaKernel<uint32_t>(tamanhos[i]) || !verificaKernel<uint64_t>(tamanhos[i])) return 1;
+      VerificaMotorFixo fixo = { tamanhos[i], true };
+      if (despachaMotorFixo(r, t, m, fixo) && (!fixo.ok || !verificaCorteFixo(tamanhos[i]))) return 1;
+      if (!verificaGrafoDisco<uint32_t>(tamanhos[i]) || !verificaImplicito<uint32_t>(tamanhos[i])) return 1;
+      if (m + 1 == t && !verificaTroca<uint32_t>(tamanhos[i])) return 1;
+      if (r <= 64 && !verificaIndiceHamming<uint64_t>(tamanhos[i])) return 1;
+      continue;
+    }
+    medeTamanho(tamanhos[i], medidas);
+  }
+  if (verifica) return 0;
+
+  if (!arquivo_csv.empty()) gravaCsv(medidas, arquivo_csv);
+  if (!arquivo_json.empty()) gravaJson(medidas, arquivo_json);
+
+  if (!arquivo_baseline.empty() && comparaBaseline(medidas, arquivo_baseline, limite_pct) > 0)
+    return 1;
+
+  return 0;
+}
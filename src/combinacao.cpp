@@ -2,6 +2,7 @@
 #include <sys/types.h>
 #include <boost/dynamic_bitset.hpp>
 #include "combinacao.h"
+#include "Binomial.h"
 using std::vector;
 
 void geraCombinacoes(std::vector<int> entrada, int numero, std::vector<std::vector<int>>& comb){
@@ -103,22 +104,76 @@ void generateAllCombos(boost::dynamic_bitset<>& combination, int index, int comb
 }
 
 /**
- * Computes the binomial coefficient n-choose-k
+ * Computes the binomial coefficient n-choose-k (a lookup in the Pascal table of
+ * Binomial.h, saturating at UINT64_MAX beyond it)
  * */
 size_t comb(size_t n, size_t k)
 {
-  size_t b[n+1];
+  return binomial(n, k);
+}
 
-  b[0] = 1;
+/**
+ * Posicao da combinacao na ordem em que generateAllCombos as gera (a ordem
+ * lexicografica dos indices marcados: as que contem o indice 0 primeiro).
+ **/
+uint64_t rankCombinacao(const boost::dynamic_bitset<>& combinacao)
+{
+  size_t n = combinacao.size();
+  size_t k = combinacao.count();
+  uint64_t rank = 0;
+  size_t i = 0;
+
+  // Cada indice x fora da combinacao, antes do i-esimo marcado, pula todas as
+  // combinacoes que marcariam x naquela posicao
+  for (size_t x = 0; x < n && i < k; ++x) {
+    if (combinacao[x]) ++i;
+    else rank += binomial(n - 1 - x, k - 1 - i);
+  }
+  return rank;
+}
 
-  for (size_t i = 1; i <= n; ++i) {
-    b[i] = 1;
-    for (size_t j = i - 1; j > 0; --j) {
-      b[j] += b[j-1];
+/** Inverso de rankCombinacao: a k-combinacao de n indices na posicao 'rank' */
+void unrankCombinacao(uint64_t rank, size_t n, size_t k, boost::dynamic_bitset<>& combinacao)
+{
+  combinacao.resize(n);
+  combinacao.reset();
+
+  for (size_t x = 0, i = 0; x < n && i < k; ++x) {
+    uint64_t com_x = binomial(n - 1 - x, k - 1 - i);
+    if (rank < com_x) {
+      combinacao[x] = true;
+      ++i;
+    } else {
+      rank -= com_x;
     }
   }
+}
+
+
+/**
+ * Rank de p_0 < ... < p_{k-1}: C(n, k) - 1 - soma C(n - 1 - p_i, k - i), a
+ * mesma conta de rankCombinacao sem percorrer as posicoes desmarcadas.
+ **/
+uint64_t rankPosicoes(const size_t* posicoes, size_t k, size_t n)
+{
+  uint64_t soma = 0;
+  for (size_t i = 0; i < k; ++i)
+    soma += binomial(n - 1 - posicoes[i], k - i);
+  return binomial(n, k) - 1 - soma;
+}
+
+bool usaComplemento(size_t n, size_t k)
+{
+  return 2 * k > n;
+}
 
-  return b[k];
+/**
+ * Tomar o complemento inverte a ordem lexicografica das combinacoes, entao
+ * rank(A) = C(n, k) - 1 - rank(complemento de A), com k = n - qtd_fora.
+ **/
+uint64_t rankPeloComplemento(const size_t* fora, size_t qtd_fora, size_t n)
+{
+  return binomial(n, qtd_fora) - 1 - rankPosicoes(fora, qtd_fora, n);
 }
 
 
@@ -134,11 +189,11 @@ size_t comb(size_t n, size_t k)
 size_t computeStartingCoverage(size_t range, size_t ticket_size,
                                size_t match_size)
 { 
-  size_t starting_coverage = 0;
+  uint64_t starting_coverage = 0;
   
   for (size_t k = match_size; k < ticket_size; ++k) {
-    starting_coverage += comb(ticket_size, k) *
-      comb(range - ticket_size, ticket_size - k);
+    starting_coverage = somaSatura(starting_coverage,
+      multiplicaSatura(binomial(ticket_size, k), binomial(range - ticket_size, ticket_size - k)));
   }
 
   return starting_coverage;
@@ -14,4 +14,17 @@ size_t computeStartingCoverage(size_t range, size_t ticket_size,
 
 size_t comb(size_t n, size_t k);
 
+// Posicao de uma combinacao na ordem de generateAllCombos, e o inverso
+uint64_t rankCombinacao(const boost::dynamic_bitset<>& combinacao);
+void unrankCombinacao(uint64_t rank, size_t n, size_t k, boost::dynamic_bitset<>& combinacao);
+
+// O mesmo rank a partir das posicoes marcadas, em ordem crescente
+uint64_t rankPosicoes(const size_t* posicoes, size_t k, size_t n);
+
+// Combinacoes com mais da metade das n posicoes ficam menores descritas pelas de fora
+bool usaComplemento(size_t n, size_t k);
+
+// Rank da combinacao de [0, n) que deixa de fora exatamente as posicoes crescentes 'fora'
+uint64_t rankPeloComplemento(const size_t* fora, size_t qtd_fora, size_t n);
+
 #endif
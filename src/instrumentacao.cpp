@@ -0,0 +1,124 @@
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "instrumentacao.h"
+#include "memoria.h"
+
+using std::string;
+using std::vector;
+
+static const char* nomes_contadores[INSTR_QTD_CONTADORES] = {
+  "dfs_empilha",
+  "dfs_desempilha",
+  "decrementos_cobertura",
+  "tickets_nivel1",
+  "atualizacoes_paralelas",
+  "reavaliacoes_lazy",
+  "rodadas_lote",
+  "shards_lidos",
+  "shards_acertos",
+  "prefixos_repetidos",
+  "varreduras_selecao",
+  "empates_soma",
+  "empates_maximo"
+};
+
+struct RegistroFase
+{
+  string nome;
+  uint64_t chamadas;
+  double parede_ns;
+  double cpu_ns;
+};
+
+// Na ordem em que cada fase apareceu pela primeira vez
+static vector<RegistroFase> fases;
+static string arquivo_relatorio;
+
+#ifndef RODALOTERIA_SEM_INSTRUMENTACAO
+
+uint64_t instr_contadores[INSTR_QTD_CONTADORES];
+
+FaseInstr::FaseInstr(const string& n)
+  : nome(n), inicio_parede(std::chrono::steady_clock::now()),
+    inicio_cpu(std::clock()), ativa(true)
+{
+  fase_anterior = memEntraFase(nome);
+}
+
+void FaseInstr::encerra()
+{
+  if (!ativa) return;
+  ativa = false;
+
+  double parede_ns = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - inicio_parede).count();
+  double cpu_ns = 1e9 * static_cast<double>(std::clock() - inicio_cpu) / CLOCKS_PER_SEC;
+
+  memMarcaFase(nome);
+  memEntraFase(fase_anterior);
+
+  for (size_t i = 0; i < fases.size(); ++i) {
+    if (fases[i].nome == nome) {
+      fases[i].chamadas++;
+      fases[i].parede_ns += parede_ns;
+      fases[i].cpu_ns += cpu_ns;
+      return;
+    }
+  }
+
+  RegistroFase r;
+  r.nome = nome;
+  r.chamadas = 1;
+  r.parede_ns = parede_ns;
+  r.cpu_ns = cpu_ns;
+  fases.push_back(r);
+}
+
+#endif
+
+bool instrGravaRelatorio(const string& arquivo)
+{
+  std::ofstream out(arquivo.c_str());
+  if (!out) {
+    std::cerr << "Nao foi possivel gravar o relatorio " << arquivo << std::endl;
+    return false;
+  }
+
+  out << "{" << std::endl;
+  out << "  \"fases\": [" << std::endl;
+  for (size_t i = 0; i < fases.size(); ++i) {
+    out << "    {\"nome\": \"" << fases[i].nome << "\", \"chamadas\": " << fases[i].chamadas
+        << ", \"parede_ns\": " << static_cast<uint64_t>(fases[i].parede_ns)
+        << ", \"cpu_ns\": " << static_cast<uint64_t>(fases[i].cpu_ns) << "}"
+        << (i + 1 < fases.size() ? "," : "") << std::endl;
+  }
+  out << "  ]," << std::endl;
+  out << "  \"contadores\": {" << std::endl;
+  for (size_t c = 0; c < INSTR_QTD_CONTADORES; ++c) {
+#ifndef RODALOTERIA_SEM_INSTRUMENTACAO
+    uint64_t valor = instr_contadores[c];
+#else
+    uint64_t valor = 0;
+#endif
+    out << "    \"" << nomes_contadores[c] << "\": " << valor
+        << (c + 1 < INSTR_QTD_CONTADORES ? "," : "") << std::endl;
+  }
+  out << "  }," << std::endl;
+  memGravaJson(out, "  ");
+  out << std::endl << "}" << std::endl;
+
+  return true;
+}
+
+static void gravaRelatorioNaSaida()
+{
+  if (!arquivo_relatorio.empty()) instrGravaRelatorio(arquivo_relatorio);
+}
+
+void instrDefineRelatorio(const string& arquivo)
+{
+  if (arquivo_relatorio.empty()) std::atexit(gravaRelatorioNaSaida);
+  arquivo_relatorio = arquivo;
+}
@@ -0,0 +1,87 @@
+/**
+ * Instrumentacao do gerador de rodas
+ *
+ * Registra o tempo de parede e de CPU de cada fase do programa (enumeracao,
+ * indexacao das garantias e dos tickets, cada tentativa do guloso, filtros e
+ * gravacao) e conta eventos dos laços mais quentes. Tudo e gravado em JSON na
+ * saida do programa quando um arquivo de relatorio foi definido com
+ * instrDefineRelatorio() (opcao --relatorio do programa principal).
+ *
+ * Os contadores sao simples incrementos em um vetor global, entao podem ficar
+ * ligados em producao. Compilando com -DRODALOTERIA_SEM_INSTRUMENTACAO todas
+ * as macros abaixo viram nada.
+ **/
+
+#ifndef INSTRUMENTACAO_H
+#define INSTRUMENTACAO_H
+
+#include <string>
+#include <stdint.h>
+#include <chrono>
+#include <ctime>
+
+enum ContadorInstr
+{
+  INSTR_DFS_EMPILHA = 0,        ///< entradas empilhadas em updatePotentials
+  INSTR_DFS_DESEMPILHA,         ///< entradas desempilhadas em updatePotentials
+  INSTR_DECREMENTOS_COBERTURA,  ///< decrementos de remaining_coverage
+  INSTR_TICKETS_NIVEL1,         ///< tickets recem cobertos (subarvores de nivel 1)
+  INSTR_ATUALIZACOES_PARALELAS, ///< chamadas de updatePotentials que usaram o pool
+  INSTR_REAVALIACOES_LAZY,      ///< ganhos exatos recalculados pelo guloso preguicoso
+  INSTR_RODADAS_LOTE,           ///< rodadas (varreduras) do guloso em lote
+  INSTR_SHARDS_LIDOS,           ///< shards do grafo em disco lidos do arquivo
+  INSTR_SHARDS_ACERTOS,         ///< consultas ao grafo em disco atendidas pelo cache
+  INSTR_PREFIXOS_REPETIDOS,     ///< tentativas cujo prefixo ja tinha sido percorrido (SimetriaRoda.h)
+  INSTR_VARREDURAS_SELECAO,     ///< varreduras completas do argmax
+  INSTR_EMPATES_SOMA,           ///< soma dos tamanhos do conjunto de empate
+  INSTR_EMPATES_MAXIMO,         ///< maior conjunto de empate visto
+  INSTR_QTD_CONTADORES
+};
+
+#ifndef RODALOTERIA_SEM_INSTRUMENTACAO
+
+extern uint64_t instr_contadores[INSTR_QTD_CONTADORES];
+
+#define INSTR_CONTA(c)        (++instr_contadores[(c)])
+#define INSTR_SOMA(c, n)      (instr_contadores[(c)] += (n))
+#define INSTR_MAXIMO(c, n)    do { if ((uint64_t)(n) > instr_contadores[(c)]) instr_contadores[(c)] = (n); } while (0)
+#define INSTR_FASE(var, nome) FaseInstr var(nome)
+#define INSTR_FASE_ENCERRA(var) var.encerra()
+
+/**
+ * Mede uma fase do programa do construtor ao destrutor (ou ate encerra()).
+ * Fases com o mesmo nome sao acumuladas no relatorio.
+ **/
+class FaseInstr
+{
+  std::string nome;
+  std::string fase_anterior;
+  std::chrono::steady_clock::time_point inicio_parede;
+  std::clock_t inicio_cpu;
+  bool ativa;
+public:
+  explicit FaseInstr(const std::string& n);
+  ~FaseInstr() { encerra(); }
+  void encerra();
+};
+
+#else
+
+#define INSTR_CONTA(c)        ((void)0)
+#define INSTR_SOMA(c, n)      ((void)0)
+#define INSTR_MAXIMO(c, n)    ((void)0)
+#define INSTR_FASE(var, nome) ((void)0)
+#define INSTR_FASE_ENCERRA(var) ((void)0)
+
+#endif
+
+/**
+ * Define o arquivo JSON gravado na saida do programa. Sem chamar esta funcao
+ * nada e gravado.
+ **/
+void instrDefineRelatorio(const std::string& arquivo);
+
+/** Grava o relatorio imediatamente; devolve false se o arquivo nao abriu. */
+bool instrGravaRelatorio(const std::string& arquivo);
+
+#endif
@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <algorithm>
+#include <new>
+#include <iostream>
+#include "memoria.h"
+#include "combinacao.h"
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using std::string;
+using std::vector;
+using std::endl;
+
+struct RegistroEstrutura
+{
+  string nome;
+  size_t bytes;
+  string fase;
+};
+
+struct RegistroPico
+{
+  string fase;
+  size_t pico_rss;
+};
+
+static vector<RegistroEstrutura> estruturas;
+static vector<RegistroPico> picos;
+static string fase_atual = "inicio";
+
+// Custo por elemento de um dynamic_bitset de 'bits' bits guardado em um vetor
+static size_t bytesBitset(size_t bits)
+{
+  typedef boost::dynamic_bitset<>::block_type bloco;
+  size_t blocos = (bits + boost::dynamic_bitset<>::bits_per_block - 1) / boost::dynamic_bitset<>::bits_per_block;
+  return sizeof(boost::dynamic_bitset<>) + blocos * sizeof(bloco);
+}
+
+size_t memBytes(const vector<boost::dynamic_bitset<> >& v)
+{
+  size_t bytes = v.capacity() * sizeof(boost::dynamic_bitset<>);
+  for (size_t i = 0; i < v.size(); ++i)
+    bytes += v[i].num_blocks() * sizeof(boost::dynamic_bitset<>::block_type);
+  return bytes;
+}
+
+void memRegistraEstrutura(const string& nome, size_t bytes)
+{
+  for (size_t i = 0; i < estruturas.size(); ++i) {
+    if (estruturas[i].nome == nome) {
+      if (bytes > estruturas[i].bytes) {
+        estruturas[i].bytes = bytes;
+        estruturas[i].fase = fase_atual;
+      }
+      return;
+    }
+  }
+
+  RegistroEstrutura r;
+  r.nome = nome;
+  r.bytes = bytes;
+  r.fase = fase_atual;
+  estruturas.push_back(r);
+}
+
+size_t memPicoRss()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return pmc.PeakWorkingSetSize;
+  return 0;
+#else
+  struct rusage uso;
+  if (getrusage(RUSAGE_SELF, &uso) != 0) return 0;
+#ifdef __APPLE__
+  return uso.ru_maxrss;
+#else
+  return static_cast<size_t>(uso.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void memMarcaFase(const string& fase)
+{
+  RegistroPico r;
+  r.fase = fase;
+  r.pico_rss = memPicoRss();
+  picos.push_back(r);
+}
+
+string memEntraFase(const string& fase)
+{
+  string anterior = fase_atual;
+  fase_atual = fase;
+  return anterior;
+}
+
+PrevisaoMemoria memPreve(size_t range, size_t ticket_size, size_t match_size, size_t qtd_busca)
+{
+  PrevisaoMemoria p;
+  uint64_t tickets = comb(range, ticket_size);
+  uint64_t garantias = comb(range, match_size);
+  uint64_t garantias_por_ticket = comb(ticket_size, match_size);
+  uint64_t tickets_por_garantia = comb(range - match_size, ticket_size - match_size);
+  size_t bitset = bytesBitset(range);
+  bool estreito = indices32Bits(range, ticket_size, match_size);
+  size_t indice = estreito ? sizeof(uint32_t) : sizeof(uint64_t);
+  size_t no_ticket = estreito ? sizeof(TicketNode) : sizeof(TicketNode64);
+  size_t no_garantia = estreito ? sizeof(MatchNode) : sizeof(MatchNode64);
+
+  p.all_tickets = tickets * bitset;
+  p.todas_garantias = garantias * bitset;
+  // Com o ticket pelo complemento (usaComplemento) as garantias saem do rank, sem mapa
+  p.garantias_idx_map = usaComplemento(range, ticket_size) ? 0 : garantias * (2 * sizeof(void*) + sizeof(size_t) +
+                                    std::max(bytesMascara(range), sizeof(uint64_t)) + sizeof(uint64_t));
+  p.ticket_nodes = tickets * (no_ticket + garantias_por_ticket * indice);
+  p.garantias_nodes = garantias * (no_garantia + tickets_por_garantia * indice);
+  p.copias_cp = qtd_busca > 1 ? p.ticket_nodes + p.garantias_nodes : 0;
+
+  // Durante a indexacao dos tickets convivem os tickets, o mapa e os dois
+  // vetores de nos; depois dela so os nos e as copias _cp
+  uint64_t indexacao = p.all_tickets + p.garantias_idx_map + p.ticket_nodes + p.garantias_nodes;
+  uint64_t busca = p.ticket_nodes + p.garantias_nodes + p.copias_cp;
+  p.pico = std::max(indexacao, busca);
+  return p;
+}
+
+static void imprimeMB(std::ostream& out, const char* nome, uint64_t bytes)
+{
+  out << "  ";
+  out.width(20);
+  out << std::left << nome << std::right;
+  out.width(12);
+  out << (bytes + (1 << 20) - 1) / (1 << 20) << " MB" << endl;
+}
+
+void memImprimePrevisao(std::ostream& out, const PrevisaoMemoria& p)
+{
+  out << "Previsao de memoria:" << endl;
+  imprimeMB(out, "all_tickets", p.all_tickets);
+  imprimeMB(out, "todas_garantias", p.todas_garantias);
+  imprimeMB(out, "garantias_idx_map", p.garantias_idx_map);
+  imprimeMB(out, "ticket_nodes", p.ticket_nodes);
+  imprimeMB(out, "garantias_nodes", p.garantias_nodes);
+  imprimeMB(out, "copias _cp", p.copias_cp);
+  imprimeMB(out, "pico estimado", p.pico);
+}
+
+static void avisoFaltaMemoria()
+{
+  std::fprintf(stderr, "\nFalta de memoria durante a fase '%s'.\n", fase_atual.c_str());
+  for (size_t i = 0; i < estruturas.size(); ++i)
+    std::fprintf(stderr, "  %-20s %12lu MB (fase %s)\n", estruturas[i].nome.c_str(),
+                 static_cast<unsigned long>(estruturas[i].bytes >> 20), estruturas[i].fase.c_str());
+  std::fprintf(stderr, "  pico de RSS          %12lu MB\n",
+               static_cast<unsigned long>(memPicoRss() >> 20));
+
+  std::set_new_handler(NULL);
+  throw std::bad_alloc();
+}
+
+void memInstalaAvisoFaltaMemoria()
+{
+  std::set_new_handler(avisoFaltaMemoria);
+}
+
+void memImprimeResumo(std::ostream& out)
+{
+  out << "Memoria por estrutura (maximo registrado):" << endl;
+  for (size_t i = 0; i < estruturas.size(); ++i)
+    imprimeMB(out, estruturas[i].nome.c_str(), estruturas[i].bytes);
+  imprimeMB(out, "pico de RSS", memPicoRss());
+}
+
+void memGravaJson(std::ostream& out, const string& recuo)
+{
+  out << recuo << "\"memoria\": {" << endl;
+  out << recuo << "  \"estruturas\": [" << endl;
+  for (size_t i = 0; i < estruturas.size(); ++i) {
+    out << recuo << "    {\"nome\": \"" << estruturas[i].nome << "\", \"bytes\": " << estruturas[i].bytes
+        << ", \"fase\": \"" << estruturas[i].fase << "\"}"
+        << (i + 1 < estruturas.size() ? "," : "") << endl;
+  }
+  out << recuo << "  ]," << endl;
+  out << recuo << "  \"pico_rss_por_fase\": [" << endl;
+  for (size_t i = 0; i < picos.size(); ++i) {
+    out << recuo << "    {\"fase\": \"" << picos[i].fase << "\", \"pico_rss_bytes\": " << picos[i].pico_rss << "}"
+        << (i + 1 < picos.size() ? "," : "") << endl;
+  }
+  out << recuo << "  ]," << endl;
+  out << recuo << "  \"pico_rss_bytes\": " << memPicoRss() << endl;
+  out << recuo << "}";
+}
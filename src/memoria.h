@@ -0,0 +1,101 @@
+/**
+ * Contabilidade de memoria do gerador de rodas
+ *
+ * Calcula os bytes ocupados pelas estruturas grandes do programa (tickets,
+ * garantias, mapa de indices das garantias, nos do grafo e as copias _cp),
+ * amostra o pico de RSS do processo nas fronteiras de fase e preve, antes de
+ * alocar qualquer coisa, quanto um problema (r, t, m) vai precisar, para que
+ * execucoes grandes possam ser abortadas logo no inicio em vez de morrerem
+ * por falta de memoria no meio do caminho.
+ **/
+
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <unordered_map>
+#include <stdint.h>
+#include <boost/dynamic_bitset.hpp>
+#include <boost/functional/hash.hpp>
+#include "wheelgen.h"
+#include "MascaraDezenas.h"
+
+// Bytes ocupados (incluindo o heap de cada elemento) por cada tipo de estrutura
+size_t memBytes(const std::vector<boost::dynamic_bitset<> >& v);
+
+// Cada no do mapa guarda o ponteiro do proximo, o par e o hash em cache
+template <class M>
+size_t memBytes(const std::unordered_map<M, uint64_t, HashMascara>& m)
+{
+  typedef typename std::unordered_map<M, uint64_t, HashMascara>::value_type par;
+  return m.bucket_count() * sizeof(void*) + m.size() * (sizeof(void*) + sizeof(par) + sizeof(size_t));
+}
+
+template <class Indice>
+size_t memBytes(const std::vector<TicketNodeT<Indice> >& v)
+{
+  size_t bytes = v.capacity() * sizeof(TicketNodeT<Indice>);
+  for (size_t i = 0; i < v.size(); ++i)
+    bytes += v[i].match_indexes.capacity() * sizeof(Indice);
+  return bytes;
+}
+
+template <class Indice>
+size_t memBytes(const std::vector<MatchNodeT<Indice> >& v)
+{
+  size_t bytes = v.capacity() * sizeof(MatchNodeT<Indice>);
+  for (size_t i = 0; i < v.size(); ++i)
+    bytes += v[i].ticket_indexes.capacity() * sizeof(Indice);
+  return bytes;
+}
+
+/**
+ * Registra o tamanho atual de uma estrutura. O relatorio guarda o maior valor
+ * visto por nome, e a ultima fase em que ele foi atualizado.
+ **/
+void memRegistraEstrutura(const std::string& nome, size_t bytes);
+
+/** Pico de memoria residente do processo ate agora, em bytes (0 se indisponivel) */
+size_t memPicoRss();
+
+/**
+ * Fronteiras de fase: memEntraFase() so guarda o nome da fase em andamento
+ * (usado no aviso de falta de memoria) e devolve o da fase anterior, para ser
+ * restaurado no fim de fases aninhadas; memMarcaFase() amostra o pico de RSS
+ * no fim da fase e guarda com o nome dela.
+ **/
+std::string memEntraFase(const std::string& fase);
+void memMarcaFase(const std::string& fase);
+
+/**
+ * Previsao de memoria para o problema (r, t, m), por estrutura e do pico
+ * esperado durante a indexacao (generateNodes) ou na copia _cp quando ha
+ * mais de uma busca.
+ **/
+struct PrevisaoMemoria
+{
+  uint64_t all_tickets;
+  uint64_t todas_garantias;
+  uint64_t garantias_idx_map;
+  uint64_t ticket_nodes;
+  uint64_t garantias_nodes;
+  uint64_t copias_cp;
+  uint64_t pico;
+};
+
+PrevisaoMemoria memPreve(size_t range, size_t ticket_size, size_t match_size, size_t qtd_busca);
+void memImprimePrevisao(std::ostream& out, const PrevisaoMemoria& p);
+
+/**
+ * Instala um new_handler que, ao faltar memoria, informa a ultima fase e as
+ * estruturas registradas antes de deixar o bad_alloc seguir.
+ **/
+void memInstalaAvisoFaltaMemoria();
+
+/** Resumo legivel e a secao "memoria" do relatorio JSON */
+void memImprimeResumo(std::ostream& out);
+void memGravaJson(std::ostream& out, const std::string& recuo);
+
+#endif
@@ -75,11 +75,13 @@
 #include <boost/functional/hash.hpp>
 #include <sys/types.h>
 #include "testeNovagen.h"
+#include "Binomial.h"
 #include <random>
 #include <chrono>
 #include <time.h>
 #include <algorithm>
 #include <boost/dynamic_bitset.hpp>
+#include "IndiceHamming.h"
 
 using std::cout;
 using std::cerr;
@@ -123,18 +125,7 @@ static string ticketToString(boost::dynamic_bitset<>& bs){
 }
 static uint64_t comb(uint64_t n, uint64_t k)
 {
-  uint64_t b[n+1];
-
-  b[0] = 1;
-
-  for (uint64_t i = 1; i <= n; ++i) {
-    b[i] = 1;
-    for (uint64_t j = i - 1; j > 0; --j) {
-      b[j] += b[j-1];
-    }
-  }
-
-  return b[k];
+  return binomial(n, k);
 }
 static  uint64_t computeStartingCoverage(uint64_t range, uint64_t ticket_size,
                                size_t match_size)
@@ -394,50 +385,25 @@ static void updateSimpleCovered(std::vector<boost::dynamic_bitset<>>& all_ticket
 		idx_remaining.erase(std::remove(idx_remaining.begin(), idx_remaining.end(), l)	,idx_remaining.end());
 	
 	}
-	
+
+	// Vizinhos com exatamente acertoGarantia dezenas em comum, por consulta de raio
+	IndiceHamming<uint64_t> indice(qtd_dezenas_jogo, 2 * (qtd_dezenas_sorteio - acertoGarantia) + 1);
+	indexaTickets(indice, all_tickets);
+	vector<bool> restantes(all_tickets.size(), false);
+	for (size_t j : idx_remaining) restantes[j] = true;
+
 	for (uint64_t i = 0; i < ticket_nodes.size(); i++){
 		if (ticket_nodes[i].is_covered)continue;
-		// for (uint64_t l:ticket_nodes[i].match_indexes){
-		// 		if (start_index==l){
-		// 			system("pause");
-		// 		}
-		// 	}
-		unsigned potencialCobre=0;
-		for (size_t j : idx_remaining)
-		{
-			//if (ticket_nodes[j].is_covered)continue;
-			if(( all_tickets[i] & all_tickets[j]).count()==acertoGarantia){
-				potencialCobre++;
-			}
-			
-	
-		}
-		
-		
-		ticket_nodes[i].remaining_coverage=potencialCobre;
-		//cout<<potencialCobre;
-		//system("pause");
-
+		ticket_nodes[i].remaining_coverage=indice.contaComuns(indice.mascara(i), acertoGarantia, restantes);
 	}
 }
 
 static void updateStartCovered(std::vector<boost::dynamic_bitset<>>& all_tickets,std::vector<TicketNode>& ticket_nodes,uint64_t start_index,uint64_t acertoGarantia){
 
-	for (uint64_t i = 0; i < ticket_nodes.size(); i++){
-		
-		unsigned potencialCobre=0;
-		for (size_t j = 0;j < ticket_nodes.size(); j++)
-		{
-			//if (ticket_nodes[j].is_covered)continue;
-			if(( all_tickets[i] & all_tickets[j]).count()==acertoGarantia){
-				potencialCobre++;
-			}
-				
-		}
-				
-		ticket_nodes[i].remaining_coverage=potencialCobre;
-	
-	}
+	IndiceHamming<uint64_t> indice(qtd_dezenas_jogo, 2 * (qtd_dezenas_sorteio - acertoGarantia) + 1);
+	indexaTickets(indice, all_tickets);
+	for (uint64_t i = 0; i < ticket_nodes.size(); i++)
+		ticket_nodes[i].remaining_coverage=indice.contaComuns(indice.mascara(i), acertoGarantia, vector<bool>());
 }
 
 static void updatePotentials(vector<TicketNode>& ticket_nodes,
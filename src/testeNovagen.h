@@ -40,8 +40,8 @@
 struct TicketNode
 //a variavel unsigned is_covered e demais seguidos de dois ponto o numero apos ele é a quantidade maxima de bits aceitavel pela variavel
 {
-  unsigned is_covered         :1;
-  unsigned remaining_coverage :31;
+  uint64_t is_covered         :1;
+  uint64_t remaining_coverage :63;
   std::vector<uint64_t> match_indexes;
   TicketNode(){}
   TicketNode(bool b_is_covered, int n_remaining_coverage,
@@ -59,10 +59,10 @@ struct MatchNode
 
 struct DFSStackEntry
 {
-  unsigned is_ticket    :1;
-  unsigned is_level_two :1;
-  unsigned is_visited   :1;
-  unsigned index        :256;
+  uint64_t is_ticket    :1;
+  uint64_t is_level_two :1;
+  uint64_t is_visited   :1;
+  uint64_t index        :61;
 
   DFSStackEntry(uint64_t idx, bool b_is_ticket, bool b_is_level_2)
     : is_ticket(b_is_ticket ? 1 : 0),
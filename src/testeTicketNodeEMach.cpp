@@ -8,6 +8,7 @@
 #include <memory>
 #include <boost/dynamic_bitset.hpp>
 #include "GeraCombIterarBitSet.h"
+#include "Binomial.h"
 #include "GeraCombIterar.h"
 #include <random>
 #include <chrono>
@@ -79,18 +80,7 @@ static std::string ticketToString(boost::dynamic_bitset<>& bs){
 
 static uint64_t comb(uint64_t n, uint64_t k)
 {
-  uint64_t b[n+1];
-
-  b[0] = 1;
-
-  for (uint64_t i = 1; i <= n; ++i) {
-    b[i] = 1;
-    for (uint64_t j = i - 1; j > 0; --j) {
-      b[j] += b[j-1];
-    }
-  }
-
-  return b[k];
+  return binomial(n, k);
 }
 static  uint64_t computeStartingCoverage(uint64_t range, uint64_t ticket_size,
                                size_t match_size)
@@ -176,7 +166,7 @@ uint64_t start_ticket_idx )
 
 					// Nó de correspondência de primeiro nível, ou seja, uma correspondência contida pelo recém-selecionado// bilhete.
 					// Coloca cada um de seus filhos descobertos (nós de ticket) na pilha DFS
-					for (std::vector<uint64_t>::const_iterator t_idx = m_node.ticket_indexes.begin();
+					for (std::vector<uint32_t>::const_iterator t_idx = m_node.ticket_indexes.begin();
 					t_idx != m_node.ticket_indexes.end(); ++t_idx)
 					{
 						TicketNode& t_node = ticket_nodes[*t_idx];
@@ -195,7 +185,7 @@ uint64_t start_ticket_idx )
 				} else {
 
 					
-					for (std::vector<uint64_t>::const_iterator t_idx = m_node.ticket_indexes.begin();
+					for (std::vector<uint32_t>::const_iterator t_idx = m_node.ticket_indexes.begin();
 					t_idx != m_node.ticket_indexes.end(); ++t_idx)
 					{
 					
@@ -64,6 +64,7 @@
 #include <iomanip>
 #include <cmath>
 #include <cstdlib>
+#include <cstdio>
 #include <iostream>
 #include <vector>
 #include <stack>
@@ -76,12 +77,36 @@
 #include <sys/types.h>
 #include "wheelgen.h"
 #include "combinacao.h"
+#include "Binomial.h"
+#include "instrumentacao.h"
+#include "memoria.h"
 #include <random>
 #include <chrono>
 #include <time.h>
 #include <algorithm>
 #include <boost/dynamic_bitset.hpp>
 #include <set>
+#include <queue>
+#include <atomic>
+#include "PoolThreads.h"
+#include "MotorFixo.h"
+#include "MascaraDezenas.h"
+#include "GrafoEmDisco.h"
+#include "MotorImplicito.h"
+#include "MotorTroca.h"
+#include "IndiceHamming.h"
+#include "SimetriaRoda.h"
+#include "BibliotecaRodas.h"
+#include "SorteioCombinacoes.h"
+#include "UniversoTickets.h"
+#include "TrabalhosLote.h"
+#include "PrazoBusca.h"
+#include "CheckpointBusca.h"
+#include "CoordenadorBusca.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 using std::cout;
 using std::cerr;
@@ -103,16 +128,154 @@ using std::unique_ptr;
  ///< numeros da loteriaRange size (r), e.g. a total de dezenas no sorteio exemplo mega-sena 60 dezenas.
 //static size_t   ///< Ticket size (t), quantidade de dezenas que vao ser sorteadas exemplo mega-sena 6
 
-static size_t qtdBusca,permitirSobreposicao,qtd_dezenas_jogo,menorAposta;
-static size_t qtd_dez_garante_acertos,qtd_dezenas_sorteio,qtd_jogos ;  ///< quantidade de dezenas de garantia de acertos
+size_t qtdBusca,permitirSobreposicao,qtd_dezenas_jogo,menorAposta;
+size_t qtd_dez_garante_acertos,qtd_dezenas_sorteio,qtd_jogos ;  ///< quantidade de dezenas de garantia de acertos
+size_t qtdThreads = 1;        ///< threads usadas pelo updatePotentials (--threads)
+size_t limiarParalelo = 256;  ///< tickets recem cobertos a partir dos quais ele usa o pool
+ModoGuloso modoGuloso = GULOSO_PADRAO;  ///< --guloso padrao|lazy|lote
+size_t tamanhoLote = 64;       ///< maximo de tickets por rodada no modo lote (--lote)
+MotorGuloso motorGuloso = MOTOR_AUTOMATICO;  ///< --motor automatico|fixo|generico|implicito|troca
+string dirGrafoDisco;          ///< diretorio do grafo em disco (--grafo-disco); vazio = grafo em memoria
+uint64_t bytesCacheGrafoDisco = UINT64_C(512) << 20;  ///< teto do cache de shards do grafo em disco
+uint64_t bytesShardGrafoDisco = UINT64_C(8) << 20;    ///< tamanho de cada shard (--shard-mb)
+size_t profundidadeSimetria = 4;  ///< --simetria N: prefixos canonizados entre as tentativas (0 desliga)
+bool manterGrafo = false;      ///< guarda os nos entre execucoes mesmo com uma tentativa (modo lote)
+static uint64_t sementeBusca = 0;                  ///< --semente N; 0 usa o relogio
+static std::atomic<uint64_t> sementesUsadas(0);
+std::atomic<size_t> menorApostaCompartilhada(SIZE_MAX);  ///< menor roda de outro processo (--trabalhador)
 
  ///< busca para aceitar o menor numero de combincao
   /** < Match size (m), quantidade de dezenas que queremos garantir de acertos no jogo
 exemplo mega-sena sorteia 6 dezenas queremos garantir 5 ent�o a garantia sera 5 */
 //unordered_map<uint64_t, uint64_t> tentativa_idx_map;
   //criado para não gerar roda novamente caso for fazer mais teste de busca
-  vector<TicketNode> ticket_nodes_cp;
-  vector<MatchNode> garantias_nodes_cp;
+  template <class Indice>
+  struct CopiaNos
+  {
+    static vector<TicketNodeT<Indice> > tickets;
+    static vector<MatchNodeT<Indice> > garantias;
+  };
+  template <class Indice> vector<TicketNodeT<Indice> > CopiaNos<Indice>::tickets;
+  template <class Indice> vector<MatchNodeT<Indice> > CopiaNos<Indice>::garantias;
+
+  // O grafo em disco tambem e montado uma vez so e reaproveitado nas buscas
+  template <class Indice>
+  struct CopiaGrafoDisco
+  {
+    static unique_ptr<GrafoEmDisco<Indice> > grafo;
+  };
+  template <class Indice> unique_ptr<GrafoEmDisco<Indice> > CopiaGrafoDisco<Indice>::grafo;
+
+  // Classes dos prefixos das tentativas ja feitas (SimetriaRoda.h)
+  static unique_ptr<PrefixosExplorados> prefixos_explorados;
+
+void limpaCopiasNos()
+{
+  CopiaNos<uint32_t>::tickets.clear();
+  CopiaNos<uint32_t>::garantias.clear();
+  CopiaNos<uint64_t>::tickets.clear();
+  CopiaNos<uint64_t>::garantias.clear();
+  CopiaGrafoDisco<uint32_t>::grafo.reset();
+  CopiaGrafoDisco<uint64_t>::grafo.reset();
+  prefixos_explorados.reset();
+}
+
+static PrefixosExplorados& prefixosExplorados()
+{
+  if (!prefixos_explorados)
+    prefixos_explorados.reset(new PrefixosExplorados(qtd_dezenas_jogo, qtd_dezenas_sorteio, profundidadeSimetria));
+  return *prefixos_explorados;
+}
+
+/**
+ * First ticket of a wheel. Every ticket is a relabeling of every other one, so
+ * with the symmetry on it is always rank 0.
+ **/
+template <class Eng>
+static uint64_t primeiroTicket(uint64_t qtd_tickets, Eng& eng)
+{
+  if (profundidadeSimetria > 0) return 0;
+  return std::uniform_int_distribution<uint64_t>(0, qtd_tickets - 1)(eng);
+}
+
+// Random tie break among the best tickets, steered toward prefixes no earlier
+// attempt has explored
+template <class Eng>
+static uint64_t desempata(const vector<uint64_t>& wheel_ticket_idxs, const vector<uint64_t>& best, Eng& eng)
+{
+  if (profundidadeSimetria > 1) return prefixosExplorados().escolhe(wheel_ticket_idxs, best, eng);
+  return best[std::uniform_int_distribution<size_t>(0, best.size() - 1)(eng)];
+}
+
+void defineSemente(uint64_t semente, uint64_t usadas)
+{
+  sementeBusca = semente;
+  sementesUsadas = usadas;
+}
+
+uint64_t sementeDefinida()
+{
+  return sementeBusca;
+}
+
+uint64_t qtdSementesUsadas()
+{
+  return sementesUsadas;
+}
+
+/**
+ * Seed for the next random generator: the clock, or with --semente a
+ * splitmix64 sequence started at that seed, so a run can be repeated.
+ **/
+uint64_t novaSemente()
+{
+  if (sementeBusca == 0) return std::chrono::system_clock::now().time_since_epoch().count();
+  uint64_t z = sementeBusca + UINT64_C(0x9E3779B97F4A7C15) * ++sementesUsadas;
+  z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+  return z ^ (z >> 31);
+}
+
+bool grafoGuardado()
+{
+  return !CopiaNos<uint32_t>::tickets.empty() || !CopiaNos<uint64_t>::tickets.empty() ||
+         CopiaGrafoDisco<uint32_t>::grafo || CopiaGrafoDisco<uint64_t>::grafo;
+}
+
+/**
+ * Stops an attempt that can no longer win: past menorAposta tickets, or past
+ * the best wheel another process already has (the wheel is kept, and is
+ * simply not smaller), or cut by the time budget or a stop
+ * signal (PrazoBusca.h), in which case the partial wheel is discarded.
+ **/
+static bool abandonaTentativa(vector<uint64_t>& wheel_ticket_idxs)
+{
+  if (wheel_ticket_idxs.size() > std::min(menorAposta, menorApostaCompartilhada.load(std::memory_order_relaxed))) {
+    cout << "Concluido, ja possui uma cobertura igual menor." << endl;
+    return true;
+  }
+  if (PrazoBusca::deveParar()) {
+    cout << "Tentativa interrompida (" << (PrazoBusca::interrompida() ? "sinal" : "prazo") << ")." << endl;
+    wheel_ticket_idxs.clear();
+    return true;
+  }
+  return false;
+}
+
+bool motorSemGrafo()
+{
+  if (motorGuloso == MOTOR_IMPLICITO || motorGuloso == MOTOR_TROCA) return true;
+  return motorGuloso == MOTOR_AUTOMATICO && modoGuloso == GULOSO_PADRAO && dirGrafoDisco.empty() &&
+         qtd_dez_garante_acertos + 1 == qtd_dezenas_sorteio;
+}
+
+bool indices32Bits(size_t range, size_t ticket_size, size_t match_size)
+{
+  // remaining_coverage nunca passa da quantidade de tickets, entao cabe nos
+  // 31 bits que sobram ao lado de is_covered
+  return binomial(range, ticket_size) < (UINT64_C(1) << 31) &&
+         binomial(range, match_size) < (UINT64_C(1) << 32);
+}
 
 /** Prints a ticket (or a match, which is like a partial ticket) in a nice, human readable format */
 static string ticketToString(boost::dynamic_bitset<>& bs){
@@ -128,14 +291,6 @@ static string ticketToString(boost::dynamic_bitset<>& bs){
 	}
 	return sstr.str();
 }
-static boost::dynamic_bitset<> convertNumBitset(std::vector<int> numeros, int max){
-
-	boost::dynamic_bitset<> convertido(max);
-	for ( int var = 0; var < numeros.size(); ++var){
-		convertido.set(numeros[var]-1);
-	}
-	return convertido;
-}
 static std::vector<int> convertBitsetNum(boost::dynamic_bitset<> numerosbit){
 	std::vector<int> bit_vector;
 	std::size_t pos = numerosbit.find_first();
@@ -145,23 +300,16 @@ static std::vector<int> convertBitsetNum(boost::dynamic_bitset<> numerosbit){
 	}
 	return bit_vector;
 }
-static std::vector<int> convertBitsetFechamento(boost::dynamic_bitset<> numerosbit,vector<int> fechamento){
-	std::vector<int> bit_vector;
-	std::size_t pos = numerosbit.find_first();
-	while (pos != boost::dynamic_bitset<>::npos) {
-		bit_vector.push_back(fechamento[pos]);
-		pos = numerosbit.find_next(pos);
-	}
-	return bit_vector;
-}
 
 /**
  * Builds the first part of the problem graph by creating a MatchNode struct for
- * each match in the todas_garantias vector.
+ * each match in the todas_garantias vector. Matches are keyed by their
+ * fixed-width mask (MascaraDezenas.h) instead of the dynamic_bitset.
  **/
+template <class M, class Indice>
 static void convertMatchesToMatchNodes(vector<boost::dynamic_bitset<>>& todas_garantias,
-                                       vector<MatchNode>& garantias_nodes,
-                                       unordered_map<boost::dynamic_bitset<>, uint64_t>& garantias_idx_map)
+                                       vector<MatchNodeT<Indice> >& garantias_nodes,
+                                       unordered_map<M, uint64_t, HashMascara>& garantias_idx_map)
 {
   size_t ticket_idx_reserve_sz = comb(qtd_dezenas_jogo - qtd_dez_garante_acertos, qtd_dezenas_sorteio - qtd_dez_garante_acertos);                  //(17     -              14 ) =3             15 -
   //    14 = 1
@@ -173,12 +321,7 @@ static void convertMatchesToMatchNodes(vector<boost::dynamic_bitset<>>& todas_ga
        m != todas_garantias.end(); ++garantias_idx, ++m)
     {
       garantias_nodes[garantias_idx].ticket_indexes.reserve(ticket_idx_reserve_sz);
-      garantias_idx_map[(*m)] = garantias_idx;
-
-    //   if (garantias_idx % 1000 == 0) {
-    //     cout << ".";
-    //     cout.flush();
-    //   }
+      garantias_idx_map[mascaraDeBitset<M>(*m)] = garantias_idx;
     }
 }
 
@@ -189,12 +332,21 @@ static void convertMatchesToMatchNodes(vector<boost::dynamic_bitset<>>& todas_ga
  * this ticket contains and "connects" the TicketNode to each of these match
  * nodes (by inserting an index reference to the ticket node in the match node
  * and vice-versa.
+ *
+ * The matches of a ticket are its m-subsets, walked in lexicographic order
+ * over the positions of its numbers and built directly as masks, so there is
+ * no per-match vector or bitset allocation.
  **/
-static void convertTicketsToTicketNodes(std::vector<boost::dynamic_bitset<>>& all_tickets,
-std::vector<TicketNode>& ticket_nodes,unordered_map<boost::dynamic_bitset<>, uint64_t> garantias_idx_map,
-std::vector<MatchNode>& garantias_nodes)
+template <class M, class Indice>
+static void convertTicketsToTicketNodes(const std::vector<boost::dynamic_bitset<>>& all_tickets,
+std::vector<TicketNodeT<Indice> >& ticket_nodes,const unordered_map<M, uint64_t, HashMascara>& garantias_idx_map,
+std::vector<MatchNodeT<Indice> >& garantias_nodes)
 {
 	size_t ticket_cover_initial_size = computeStartingCoverage(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos);
+	size_t match_idx_reserve_sz = comb(qtd_dezenas_sorteio, qtd_dez_garante_acertos);
+	size_t m_sz = qtd_dez_garante_acertos;
+	size_t posicoes[MASCARA_MAX_DEZENAS];
+	size_t escolha[MASCARA_MAX_DEZENAS];
 	uint64_t ticket_idx = 0;
 
 
@@ -207,131 +359,226 @@ std::vector<MatchNode>& garantias_nodes)
 
 		ticket_nodes[ticket_idx].is_covered = 0;
 		ticket_nodes[ticket_idx].remaining_coverage = ticket_cover_initial_size;
-			uint64_t garantias_idx = 0;
-
-		vector<vector<int>> matches_for_ticket;
-		vector<int> entrada= convertBitsetNum(*t);
-		geraCombinacoes(entrada, qtd_dez_garante_acertos, matches_for_ticket);
-
-		for (vector<vector<int>>::const_iterator m = matches_for_ticket.begin();
-			m != matches_for_ticket.end();++garantias_idx, ++m)
-		{
-
-				uint64_t garantias_idx = (garantias_idx_map.find(convertNumBitset((*m),(*t).size())))->second;
-				ticket_nodes[ticket_idx].match_indexes.push_back(garantias_idx);
-				garantias_nodes[garantias_idx].ticket_indexes.push_back(ticket_idx);
-			//std::cout<<i<<"\n";
-			// system("pause");
-
+		ticket_nodes[ticket_idx].match_indexes.reserve(match_idx_reserve_sz);
+
+		size_t qtd_pos = 0;
+		for (size_t pos = t->find_first(); pos != boost::dynamic_bitset<>::npos; pos = t->find_next(pos))
+			posicoes[qtd_pos++] = pos;
+		for (size_t i = 0; i < m_sz; ++i)
+			escolha[i] = i;
+
+		while (true) {
+			M garantia = M();
+			for (size_t i = 0; i < m_sz; ++i)
+				mascaraLiga(garantia, posicoes[escolha[i]]);
+
+			uint64_t garantias_idx = garantias_idx_map.find(garantia)->second;
+			ticket_nodes[ticket_idx].match_indexes.push_back(garantias_idx);
+			garantias_nodes[garantias_idx].ticket_indexes.push_back(ticket_idx);
+
+			// Proxima m-combinacao das posicoes
+			size_t i = m_sz;
+			while (i > 0 && escolha[i - 1] == qtd_pos - m_sz + i - 1) --i;
+			if (i == 0) break;
+			++escolha[i - 1];
+			for (size_t j = i; j < m_sz; ++j) escolha[j] = escolha[j - 1] + 1;
 		}
-
-
-	}
-	if (ticket_idx % 1000 == 0) {
-		cout << ".";
-		cout.flush();
 	}
 }
 
-/**
- * Builds the problem graph - converts ticket and match descriptions to
- * interconnected ticket and match nodes, and in the process loses the
- * description information.
- **/
-static void generateNodes(std::vector<boost::dynamic_bitset<>>& all_tickets,
-                          std::vector<boost::dynamic_bitset<>>& todas_garantias,
-                          vector<TicketNode>& ticket_nodes,
-                          vector<MatchNode>& garantias_nodes)
+template <class M, class Indice>
+static void generateNodesMascara(const std::vector<boost::dynamic_bitset<>>& all_tickets,
+                                 std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                                 vector<TicketNodeT<Indice> >& ticket_nodes,
+                                 vector<MatchNodeT<Indice> >& garantias_nodes)
 {
- unordered_map<boost::dynamic_bitset<>, uint64_t> garantias_idx_map(todas_garantias.size());
+ unordered_map<M, uint64_t, HashMascara> garantias_idx_map(todas_garantias.size());
 
+  INSTR_FASE(fase_garantias, "indexa_garantias");
   cout << "Indexando todas garantias...";
   cout.flush();
   convertMatchesToMatchNodes(todas_garantias, garantias_nodes, garantias_idx_map);
+  memRegistraEstrutura("todas_garantias", memBytes(todas_garantias));
+  memRegistraEstrutura("garantias_idx_map", memBytes(garantias_idx_map));
   todas_garantias.clear();
   todas_garantias.reserve(0);
+  INSTR_FASE_ENCERRA(fase_garantias);
 
   cout << "done." << endl;
 
+  INSTR_FASE(fase_tickets, "indexa_tickets");
   cout << "Indexando todos tickets...";
   cout.flush();
   convertTicketsToTicketNodes(all_tickets, ticket_nodes,garantias_idx_map,garantias_nodes);
+  memRegistraEstrutura("all_tickets", memBytes(all_tickets));
+  memRegistraEstrutura("ticket_nodes", memBytes(ticket_nodes));
+  memRegistraEstrutura("garantias_nodes", memBytes(garantias_nodes));
   garantias_idx_map.clear();
   garantias_idx_map.reserve(0);
-  all_tickets.clear();
-  all_tickets.reserve(0);
 
    cout << "done." << endl;
 }
 
-
 /**
- * This is the part that makes this generator fast. Here we do an efficient
- * depth-first walk of the problem graph and update the coverage potentials of
- * all tickets based on the ticket that we just selected for the wheel. Because
- * the coverage potentials are kept accurate, the selection of the next ticket
- * can always be done in O(n) time.
+ * Same graph as convertTicketsToTicketNodes, for tickets holding more than half
+ * of the range, built in complement terms: a ticket is described by its r - t
+ * numbers left out, and each of its matches leaves out t - m more of the
+ * ticket's numbers. A match's index is its rank, taken through whichever of
+ * its numbers or its left-out numbers is the smaller set, so no lookup table
+ * of matches is needed. Removing (t - m)-subsets in lexicographic order yields
+ * the matches in reverse lexicographic order, so each list is filled from the
+ * back to keep the order of generateNodes.
  **/
-static void updateSimpleCovered(std::vector<boost::dynamic_bitset<>>& all_tickets,std::vector<TicketNode>& ticket_nodes,std::vector<uint64_t> rodaLoteria,uint64_t acertoGarantia ){
+template <class Indice>
+static void convertTicketsToTicketNodesComplemento(const std::vector<boost::dynamic_bitset<>>& all_tickets,
+                                                   std::vector<TicketNodeT<Indice> >& ticket_nodes,
+                                                   std::vector<MatchNodeT<Indice> >& garantias_nodes)
+{
+	size_t range = qtd_dezenas_jogo;
+	size_t m_sz = qtd_dez_garante_acertos;
+	size_t tira = qtd_dezenas_sorteio - m_sz;
+	size_t ticket_cover_initial_size = computeStartingCoverage(range, qtd_dezenas_sorteio, m_sz);
+	size_t qtd_garantias = comb(qtd_dezenas_sorteio, m_sz);
+	bool pelo_complemento = usaComplemento(range, m_sz);
+	size_t dentro[MASCARA_MAX_DEZENAS], fora[MASCARA_MAX_DEZENAS];
+	size_t escolha[MASCARA_MAX_DEZENAS], garantia[MASCARA_MAX_DEZENAS];
+	uint64_t ticket_idx = 0;
 
-	int idxRoda=0;
-	bool cobre=false;
-	for (uint64_t i = 0; i < all_tickets.size(); i++){
-		if(ticket_nodes[i].is_covered)continue;
-		uint64_t potencialCobre=0;
-		if(idxRoda<rodaLoteria.size()){
-			if(rodaLoteria[idxRoda]==i){
-				idxRoda++;
-				continue;
-			}
-			boost::dynamic_bitset<> ver = all_tickets[rodaLoteria[idxRoda]]&all_tickets[i];
-			idxRoda++;
-			if (ver.count()==acertoGarantia)continue;
-
-		}else
-			idxRoda=0;
-
-		for (uint64_t j = 0;j < all_tickets.size(); j++){
-			if(i==j)continue;
-			if(idxRoda<rodaLoteria.size()){
-				if(rodaLoteria[idxRoda]==j){
-					idxRoda++;
-					continue;
+	ticket_nodes.resize(all_tickets.size());
+
+	for (std::vector<boost::dynamic_bitset<>>::const_iterator t = all_tickets.begin();
+		t != all_tickets.end(); ++ticket_idx, ++t)
+	{
+		TicketNodeT<Indice>& node = ticket_nodes[ticket_idx];
+		node.is_covered = 0;
+		node.remaining_coverage = ticket_cover_initial_size;
+		node.match_indexes.resize(qtd_garantias);
+
+		size_t qtd_dentro = 0, qtd_fora = 0;
+		for (size_t x = 0; x < range; ++x) {
+			if ((*t)[x]) dentro[qtd_dentro++] = x;
+			else fora[qtd_fora++] = x;
+		}
+		for (size_t i = 0; i < tira; ++i)
+			escolha[i] = i;
+
+		for (size_t n = qtd_garantias; n-- > 0;) {
+			size_t qtd = 0;
+			if (pelo_complemento) {
+				// Dezenas de fora da garantia: as do ticket mais as retiradas
+				size_t a = 0, b = 0;
+				while (a < qtd_fora || b < tira) {
+					if (b == tira || (a < qtd_fora && fora[a] < dentro[escolha[b]])) garantia[qtd++] = fora[a++];
+					else garantia[qtd++] = dentro[escolha[b++]];
 				}
-				boost::dynamic_bitset<> ver = all_tickets[rodaLoteria[idxRoda]]&all_tickets[j];
-				idxRoda++;
-				if (ver.count()==acertoGarantia){
-					continue;
+				node.match_indexes[n] = rankPeloComplemento(garantia, qtd, range);
+			} else {
+				for (size_t i = 0, b = 0; i < qtd_dentro; ++i) {
+					if (b < tira && escolha[b] == i) ++b;
+					else garantia[qtd++] = dentro[i];
 				}
-
-
-			}else{
-				idxRoda=0;
-			}
-			boost::dynamic_bitset<> ver = all_tickets[i]&all_tickets[j];
-			//std::cout<<j<<" ";
-			if (ver.count()==acertoGarantia){
-				potencialCobre++;
+				node.match_indexes[n] = rankPosicoes(garantia, qtd, range);
 			}
 
+			// Proxima (t - m)-combinacao das dezenas a retirar
+			size_t i = tira;
+			while (i > 0 && escolha[i - 1] == qtd_dentro - tira + i - 1) --i;
+			if (i == 0) break;
+			++escolha[i - 1];
+			for (size_t j = i; j < tira; ++j) escolha[j] = escolha[j - 1] + 1;
 		}
-		ticket_nodes[i].remaining_coverage=potencialCobre++;
 
+		for (size_t k = 0; k < qtd_garantias; ++k)
+			garantias_nodes[node.match_indexes[k]].ticket_indexes.push_back(ticket_idx);
 	}
 }
 
-static void updatePotentials(vector<TicketNode>& ticket_nodes,
-                             vector<MatchNode>& garantias_nodes,
-                             uint64_t start_ticket_idx,
-                             uint64_t& total_coverage,
-                             size_t one_pct)
+template <class Indice>
+static void generateNodesComplemento(const std::vector<boost::dynamic_bitset<>>& all_tickets,
+                                     uint64_t qtd_garantias,
+                                     vector<TicketNodeT<Indice> >& ticket_nodes,
+                                     vector<MatchNodeT<Indice> >& garantias_nodes)
+{
+  INSTR_FASE(fase_garantias, "indexa_garantias");
+  cout << "Indexando todas garantias (pelo complemento)...";
+  cout.flush();
+  size_t ticket_idx_reserve_sz = comb(qtd_dezenas_jogo - qtd_dez_garante_acertos, qtd_dezenas_sorteio - qtd_dez_garante_acertos);
+  garantias_nodes.resize(qtd_garantias);
+  for (size_t i = 0; i < garantias_nodes.size(); ++i)
+    garantias_nodes[i].ticket_indexes.reserve(ticket_idx_reserve_sz);
+  INSTR_FASE_ENCERRA(fase_garantias);
+
+  cout << "done." << endl;
+
+  INSTR_FASE(fase_tickets, "indexa_tickets");
+  cout << "Indexando todos tickets...";
+  cout.flush();
+  convertTicketsToTicketNodesComplemento(all_tickets, ticket_nodes, garantias_nodes);
+  memRegistraEstrutura("all_tickets", memBytes(all_tickets));
+  memRegistraEstrutura("ticket_nodes", memBytes(ticket_nodes));
+  memRegistraEstrutura("garantias_nodes", memBytes(garantias_nodes));
+
+   cout << "done." << endl;
+}
+
+// Liga o despacho de despachaMascara() a generateNodesMascara
+template <class Indice>
+struct IndexaNos
+{
+  const std::vector<boost::dynamic_bitset<> >& all_tickets;
+  std::vector<boost::dynamic_bitset<> >& todas_garantias;
+  vector<TicketNodeT<Indice> >& ticket_nodes;
+  vector<MatchNodeT<Indice> >& garantias_nodes;
+
+  template <class M>
+  void executa()
+  {
+    generateNodesMascara<M>(all_tickets, todas_garantias, ticket_nodes, garantias_nodes);
+  }
+};
+
+/**
+ * Builds the problem graph - converts ticket and match descriptions to
+ * interconnected ticket and match nodes, and in the process loses the
+ * description information. Tickets holding more than half of the range are
+ * indexed in complement terms, where a match is only its rank and the match
+ * list may come empty; otherwise the narrowest mask that holds the range is
+ * used for indexing the matches.
+ **/
+template <class Indice>
+void generateNodes(const std::vector<boost::dynamic_bitset<>>& all_tickets,
+                          std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                          vector<TicketNodeT<Indice> >& ticket_nodes,
+                          vector<MatchNodeT<Indice> >& garantias_nodes)
+{
+  if (usaComplemento(qtd_dezenas_jogo, qtd_dezenas_sorteio)) {
+    todas_garantias.clear();
+    todas_garantias.reserve(0);
+    generateNodesComplemento(all_tickets, binomial(qtd_dezenas_jogo, qtd_dez_garante_acertos), ticket_nodes,
+                             garantias_nodes);
+    return;
+  }
+  IndexaNos<Indice> indexa = { all_tickets, todas_garantias, ticket_nodes, garantias_nodes };
+  if (!despachaMascara(qtd_dezenas_jogo, indexa))
+    cerr << "Ranges larger than " << MASCARA_MAX_DEZENAS << " are not supported." << endl;
+}
+
+
+/**
+ * Original stack-based version of updatePotentials, kept as the reference the
+ * stackless kernel below is checked against (RodaLoteriaBench --verifica).
+ **/
+template <class Indice>
+void updatePotentialsDFS(vector<TicketNodeT<Indice> >& ticket_nodes,
+                             vector<MatchNodeT<Indice> >& garantias_nodes,
+                             uint64_t start_ticket_idx)
 {
 	stack<DFSStackEntry> dfs_stack;
-	uint64_t current_level1_ticket_idx = 0;
 
 	unique_ptr<vector<bool> > charged_level2_ticket_idxs(new vector<bool>(ticket_nodes.size()));
 
 	dfs_stack.push(DFSStackEntry(start_ticket_idx, true, false));
+	INSTR_CONTA(INSTR_DFS_EMPILHA);
 
 	while (!dfs_stack.empty()) {
 
@@ -343,7 +590,7 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 
 			if (visit_node.is_ticket){
 
-				TicketNode& t_node = ticket_nodes[visit_node.index];
+				TicketNodeT<Indice>& t_node = ticket_nodes[visit_node.index];
 				//verifica se e o ticket atual visitado
 				bool is_start_ticket = (visit_node.index == start_ticket_idx);
 				if (!visit_node.is_level_two) {
@@ -351,6 +598,7 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 					//impede que delete o ticket do top que foi o selecionado
 					if (!is_start_ticket && t_node.is_covered) {
 						dfs_stack.pop();
+						INSTR_CONTA(INSTR_DFS_DESEMPILHA);
 						continue;
 					}
 
@@ -358,10 +606,11 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 					// Se o no nao for coberto recentemente, coloque todos os seus filhos (que sao
 					// corresponde aos nos) na pilha DFS a ser visitada
 
-					for (vector<uint32_t>::const_iterator m_idx = t_node.match_indexes.begin();
+					for (typename vector<Indice>::const_iterator m_idx = t_node.match_indexes.begin();
 						m_idx != t_node.match_indexes.end(); ++m_idx)
 					{
 						dfs_stack.push(DFSStackEntry(*m_idx, false, !is_start_ticket));
+						INSTR_CONTA(INSTR_DFS_EMPILHA);
 					}
 
 					//não entr ana primeira iteração
@@ -374,8 +623,8 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 						// Charge for inability to cover self
 						// Cobranca por incapacidade de cobrir a si mesmo
 						t_node.remaining_coverage -= std::min<uint64_t>(t_node.remaining_coverage, 1);
+						INSTR_CONTA(INSTR_DECREMENTOS_COBERTURA);
 
-						current_level1_ticket_idx = visit_node.index;
 						charged_level2_ticket_idxs.reset(new vector<bool>(ticket_nodes.size()));
 						(*charged_level2_ticket_idxs)[visit_node.index] = true;
 					}
@@ -394,27 +643,29 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 
 			} else {
 
-				MatchNode& m_node = garantias_nodes[visit_node.index];
+				MatchNodeT<Indice>& m_node = garantias_nodes[visit_node.index];
 
 				if (!visit_node.is_level_two) {
 
 					// Nó de correspondência de primeiro nível, ou seja, uma correspondência contida pelo recém-selecionado// bilhete.
 					// Coloca cada um de seus filhos descobertos (nós de ticket) na pilha DFS
-					for (vector<uint64_t>::const_iterator t_idx = m_node.ticket_indexes.begin();
+					for (typename vector<Indice>::const_iterator t_idx = m_node.ticket_indexes.begin();
 					t_idx != m_node.ticket_indexes.end(); ++t_idx)
 					{
-						TicketNode& t_node = ticket_nodes[*t_idx];
+						TicketNodeT<Indice>& t_node = ticket_nodes[*t_idx];
 
 						// Cobrança por incapacidade de cobrir  o ticket do topo
 						//esse ticket do topo cobriu antes desses então a redução para que ele possa cobrir
 						//qualquer outros menos esses
 						t_node.remaining_coverage -= std::min<uint64_t>(t_node.remaining_coverage, 1);
+						INSTR_CONTA(INSTR_DECREMENTOS_COBERTURA);
 
 						// Só insere no de garantia se ela estiver descoberta, pois não precisamos fazer
 						// quaisquer reduções de cobertura nas subárvores já cobertas
 						// nós de ticket.
 						if (!t_node.is_covered) {
 							dfs_stack.push(DFSStackEntry(*t_idx, true, false));
+							INSTR_CONTA(INSTR_DFS_EMPILHA);
 						}
 					}
 
@@ -428,7 +679,7 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 					// push these children onto the stack. Each child represents a ticket
 					// that is losing the potential to cover the newly-covered ticket that
 					// is the root of the subtree we are currently traversing.
-					for (vector<uint64_t>::const_iterator t_idx = m_node.ticket_indexes.begin();
+					for (typename vector<Indice>::const_iterator t_idx = m_node.ticket_indexes.begin();
 					t_idx != m_node.ticket_indexes.end(); ++t_idx)
 					{
 
@@ -438,15 +689,17 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 						// mesma subárvore
 						if (!(*charged_level2_ticket_idxs)[*t_idx]) {
 
-							TicketNode& t_node = ticket_nodes[*t_idx];
+							TicketNodeT<Indice>& t_node = ticket_nodes[*t_idx];
 							// Cobrança por incapacidade de cobrir o atual nível-2 (do total
 							// árvore) bilhete
 							t_node.remaining_coverage -= std::min<uint64_t>(t_node.remaining_coverage, 1);
+							INSTR_CONTA(INSTR_DECREMENTOS_COBERTURA);
 							(*charged_level2_ticket_idxs)[*t_idx] = true;
 						}
 					}
 
 					dfs_stack.pop();
+					INSTR_CONTA(INSTR_DFS_DESEMPILHA);
 				}
 			}
 
@@ -456,183 +709,964 @@ static void updatePotentials(vector<TicketNode>& ticket_nodes,
 			// to its parent.
 
 				dfs_stack.pop();
+				INSTR_CONTA(INSTR_DFS_DESEMPILHA);
 		}
 	}
 }
 
+// Marcas de cobranca do nivel 2: marcas[t] == epoca quando o ticket t ja foi
+// cobrado na subarvore atual. Trocar de epoca substitui a alocacao de um
+// vector<bool> do tamanho do grafo a cada ticket de nivel 1. Cada thread do
+// pool tem as suas.
+struct MarcasNivel2
+{
+  vector<uint32_t> marcas;
+  uint32_t epoca;
+  vector<uint64_t> tocados;   ///< tickets com cobranca pendente (so no modo paralelo)
+
+  MarcasNivel2() : epoca(0) {}
+
+  uint32_t novaEpoca(size_t qtd_tickets)
+  {
+    if (marcas.size() != qtd_tickets || epoca == UINT32_MAX) {
+      marcas.assign(qtd_tickets, 0);
+      epoca = 0;
+    }
+    return ++epoca;
+  }
+};
+
+static MarcasNivel2 marcas_serial;
+static vector<uint64_t> novos_cobertos;
+
+// Pool e cobrancas acumuladas do modo paralelo, criados na primeira vez que
+// uma atualizacao passa de limiarParalelo tickets recem cobertos
+static unique_ptr<PoolThreads> pool_threads;
+static vector<MarcasNivel2> marcas_threads;
+static unique_ptr<std::atomic<uint32_t>[]> cobrancas_pendentes;
+static size_t cobrancas_pendentes_sz = 0;
+
 /**
- * Generates a lottery wheel in a naiively greedy manner by continually
- * selecting the ticket with the largest remaining coverage potential, until the
- * largest remaining coverage potential is zero.
+ * Charges, once, every ticket that shares a match with the newly covered
+ * ticket level1_idx (it can no longer cover it). With 'pendentes' the charge is
+ * only accumulated there, for the parallel path to apply later.
  **/
-
-static void generateWheel(std::vector<boost::dynamic_bitset<>>& all_tickets,
-                          std::vector<boost::dynamic_bitset<>>& todas_garantias,
-                          std::vector<uint64_t>& wheel_ticket_idxs)
+template <class Indice>
+static void chargeLevel2Subtree(vector<TicketNodeT<Indice> >& ticket_nodes,
+                                const vector<MatchNodeT<Indice> >& garantias_nodes,
+                                uint64_t level1_idx, MarcasNivel2& marcas,
+                                std::atomic<uint32_t>* pendentes)
 {
-  vector<TicketNode> ticket_nodes;
-  vector<MatchNode> garantias_nodes;
+	uint32_t epoca = marcas.novaEpoca(ticket_nodes.size());
+	marcas.marcas[level1_idx] = epoca;
 
-  uint64_t total_coverage = 0;//,criado para o status do programa info...
-  bool is_first_iteration = true;
-  bool done = false;
-  size_t one_pct;
+	const vector<Indice>& level1_matches = ticket_nodes[level1_idx].match_indexes;
+	for (size_t k = 0; k < level1_matches.size(); ++k) {
 
-  if (ticket_nodes_cp.empty()){
-  	generateNodes(all_tickets, todas_garantias, ticket_nodes, garantias_nodes);
-	if(qtdBusca > 1){
-		ticket_nodes_cp = ticket_nodes;
-		garantias_nodes_cp =  garantias_nodes;
+		const vector<Indice>& level2_tickets = garantias_nodes[level1_matches[k]].ticket_indexes;
+
+		for (size_t l = 0; l < level2_tickets.size(); ++l) {
+			uint64_t level2_idx = level2_tickets[l];
+			if (marcas.marcas[level2_idx] == epoca)
+				continue;
+			marcas.marcas[level2_idx] = epoca;
+
+			if (pendentes) {
+				if (pendentes[level2_idx].fetch_add(1, std::memory_order_relaxed) == 0)
+					marcas.tocados.push_back(level2_idx);
+			} else {
+				TicketNodeT<Indice>& u_node = ticket_nodes[level2_idx];
+				u_node.remaining_coverage -= std::min<uint64_t>(u_node.remaining_coverage, 1);
+				INSTR_CONTA(INSTR_DECREMENTOS_COBERTURA);
+			}
 		}
-  }else{
-	if(qtdBusca>1){
-		ticket_nodes = ticket_nodes_cp;
-		garantias_nodes = garantias_nodes_cp;
 	}
-  }
-
-  one_pct = std::max(ticket_nodes.size() / 100, static_cast<size_t>(1));
+}
 
-  cout << "Gerando Roda da loteria..." << endl;
+/**
+ * Parallel level-2 charging: the newly covered tickets are split across the
+ * pool, each thread with its own double-charge marks, and the charges are
+ * summed in relaxed atomic counters. After the barrier every thread applies
+ * the totals of the tickets it touched first; since the decrements saturate
+ * at zero, applying k charges at once is the same as applying them one by one.
+ **/
+template <class Indice>
+static void chargeLevel2Parallel(vector<TicketNodeT<Indice> >& ticket_nodes,
+                                 const vector<MatchNodeT<Indice> >& garantias_nodes)
+{
+	size_t qtd = pool_threads->tamanho();
 
-  while (!done) {
+	if (cobrancas_pendentes_sz != ticket_nodes.size()) {
+		cobrancas_pendentes.reset(new std::atomic<uint32_t>[ticket_nodes.size()]);
+		for (size_t i = 0; i < ticket_nodes.size(); ++i)
+			cobrancas_pendentes[i].store(0, std::memory_order_relaxed);
+		cobrancas_pendentes_sz = ticket_nodes.size();
+	}
+	marcas_threads.resize(qtd);
+
+	std::atomic<uint32_t>* pendentes = cobrancas_pendentes.get();
+
+	pool_threads->executa(novos_cobertos.size(), [&](size_t inicio, size_t fim, size_t id) {
+		MarcasNivel2& marcas = marcas_threads[id];
+		marcas.tocados.clear();
+		for (size_t i = inicio; i < fim; ++i)
+			chargeLevel2Subtree(ticket_nodes, garantias_nodes, novos_cobertos[i], marcas, pendentes);
+	});
+
+	pool_threads->executa(qtd, [&](size_t inicio, size_t fim, size_t) {
+		for (size_t id = inicio; id < fim; ++id) {
+			const vector<uint64_t>& tocados = marcas_threads[id].tocados;
+			for (size_t i = 0; i < tocados.size(); ++i) {
+				uint32_t cobranca = pendentes[tocados[i]].exchange(0, std::memory_order_relaxed);
+				TicketNodeT<Indice>& u_node = ticket_nodes[tocados[i]];
+				u_node.remaining_coverage -= std::min<uint64_t>(u_node.remaining_coverage, cobranca);
+			}
+		}
+	});
 
-    uint64_t start_ticket_idx;
+	INSTR_CONTA(INSTR_ATUALIZACOES_PARALELAS);
+}
 
-    if (is_first_iteration) {
+/**
+ * Same charging as updatePotentialsDFS, written for the fixed shape of the
+ * walk (start ticket -> match -> ticket -> match -> ticket) as loops over the
+ * adjacency vectors, with no stack at all:
+ *
+ *  - every ticket sharing a match with the start ticket loses one unit of
+ *    potential (it can no longer cover the start ticket);
+ *  - every such ticket that was not yet covered becomes covered, pays for not
+ *    being able to cover itself, and every ticket sharing a match with it is
+ *    charged once (it can no longer cover this newly covered ticket).
+ *
+ * Decrements saturate at zero, so the order in which they are applied does not
+ * change the result and this produces exactly the same nodes as the DFS. That
+ * is also what allows the second level, by far the largest, to be split across
+ * qtdThreads threads when a selection covers at least limiarParalelo tickets.
+ **/
+template <class Indice>
+void updatePotentials(vector<TicketNodeT<Indice> >& ticket_nodes,
+                      vector<MatchNodeT<Indice> >& garantias_nodes,
+                      uint64_t start_ticket_idx)
+{
+	const vector<Indice>& start_matches = ticket_nodes[start_ticket_idx].match_indexes;
 
-     unsigned long seed1 = std::chrono::system_clock::now().time_since_epoch().count();
-     std::mt19937_64 eng(seed1);
-     std::uniform_int_distribution<unsigned int> distr(0, ticket_nodes.size()-1);
-	   //start_ticket_idx = 0;
+	novos_cobertos.clear();
 
-	  start_ticket_idx = distr(eng);
+	for (size_t i = 0; i < start_matches.size(); ++i) {
 
-	  is_first_iteration = false;
+		const vector<Indice>& level1_tickets = garantias_nodes[start_matches[i]].ticket_indexes;
 
-    } else {
+		for (size_t j = 0; j < level1_tickets.size(); ++j) {
 
-      start_ticket_idx = 0;
+			TicketNodeT<Indice>& t_node = ticket_nodes[level1_tickets[j]];
 
-      uint64_t best_coverage_sz = 0;
-      vector<uint64_t> best_coverage_ticket_idxs;
+			// Cobranca por incapacidade de cobrir o ticket do topo
+			t_node.remaining_coverage -= std::min<uint64_t>(t_node.remaining_coverage, 1);
+			INSTR_CONTA(INSTR_DECREMENTOS_COBERTURA);
 
+			if (t_node.is_covered)
+				continue;
 
-      for (uint64_t ticket_idx = 0; ticket_idx < ticket_nodes.size(); ++ticket_idx) {
-		uint64_t remaining_coverage = ticket_nodes[ticket_idx].remaining_coverage;
-		if (remaining_coverage > best_coverage_sz) {
-			best_coverage_ticket_idxs.clear();
-			best_coverage_ticket_idxs.push_back(ticket_idx);
-			best_coverage_sz = remaining_coverage;
-		} else if (remaining_coverage == best_coverage_sz) {
-			best_coverage_ticket_idxs.push_back(ticket_idx);
+			// Ticket recem coberto: cobra por nao poder cobrir a si mesmo
+			t_node.is_covered = 1;
+			t_node.remaining_coverage -= std::min<uint64_t>(t_node.remaining_coverage, 1);
+			INSTR_CONTA(INSTR_DECREMENTOS_COBERTURA);
+			novos_cobertos.push_back(level1_tickets[j]);
 		}
-      }
-
-      // cout << "\t Next best coverage is " << best_coverage_sz << " (by "
-      //      << best_coverage_ticket_idxs.size() << " tickets)" << endl;
+	}
 
-      if (best_coverage_sz == 0) {
-        done = true;
-		cout << "Concluido." << endl;
-        break;
-      }
+	INSTR_SOMA(INSTR_TICKETS_NIVEL1, novos_cobertos.size());
 
-      // If more than one ticket has maximal coverage potential, select randomly
-      // from among the set that do.
-      unsigned seed1 = std::chrono::system_clock::now().time_since_epoch().count();
-	  std::mt19937_64 eng(seed1);
-      std::uniform_int_distribution<unsigned int> distr(0, best_coverage_ticket_idxs.size()-1);
+	if (qtdThreads > 1 && novos_cobertos.size() >= limiarParalelo) {
+		if (!pool_threads || pool_threads->tamanho() != qtdThreads)
+			pool_threads.reset(new PoolThreads(qtdThreads));
+		chargeLevel2Parallel(ticket_nodes, garantias_nodes);
+		return;
+	}
 
-	  start_ticket_idx = best_coverage_ticket_idxs[distr(eng)];
+	for (size_t i = 0; i < novos_cobertos.size(); ++i)
+		chargeLevel2Subtree(ticket_nodes, garantias_nodes, novos_cobertos[i], marcas_serial, NULL);
+}
 
-		if(permitirSobreposicao==0){
-			bool foiCoberto = false;
+/**
+ * Scans every ticket node and collects the indexes of those holding the largest
+ * remaining coverage potential. Returns that potential (zero once every ticket
+ * is covered).
+ **/
+template <class Indice>
+uint64_t findBestCoverageTickets(const vector<TicketNodeT<Indice> >& ticket_nodes,
+                                 vector<uint64_t>& best_coverage_ticket_idxs)
+{
+  uint64_t best_coverage_sz = 0;
+
+  best_coverage_ticket_idxs.clear();
+  INSTR_CONTA(INSTR_VARREDURAS_SELECAO);
+
+  for (uint64_t ticket_idx = 0; ticket_idx < ticket_nodes.size(); ++ticket_idx) {
+	uint64_t remaining_coverage = ticket_nodes[ticket_idx].remaining_coverage;
+	if (remaining_coverage > best_coverage_sz) {
+		best_coverage_ticket_idxs.clear();
+		best_coverage_ticket_idxs.push_back(ticket_idx);
+		best_coverage_sz = remaining_coverage;
+	} else if (remaining_coverage == best_coverage_sz) {
+		best_coverage_ticket_idxs.push_back(ticket_idx);
+	}
+  }
 
-			for (int i=0; i< wheel_ticket_idxs.size();++i){
+  INSTR_SOMA(INSTR_EMPATES_SOMA, best_coverage_ticket_idxs.size());
+  INSTR_MAXIMO(INSTR_EMPATES_MAXIMO, best_coverage_ticket_idxs.size());
+  return best_coverage_sz;
+}
 
-				for (int j =0;  j < ticket_nodes[wheel_ticket_idxs[i]].match_indexes.size(); ++j){
+// Candidato do guloso preguicoso: 'ganho' e um limite superior do ganho real,
+// valido desde a ultima vez que ele foi reavaliado
+struct CandidatoLazy
+{
+  uint64_t ganho;
+  uint32_t desempate;
+  uint64_t ticket_idx;
+
+  bool operator<(const CandidatoLazy& outro) const
+  {
+    if (ganho != outro.ganho) return ganho < outro.ganho;
+    return desempate < outro.desempate;
+  }
+};
 
-					for (int k = 0; k < ticket_nodes[start_ticket_idx].match_indexes.size(); ++k){
+/**
+ * Exact marginal gain of selecting ticket_idx: the number of still uncovered
+ * tickets (itself included) that share at least one match with it.
+ **/
+template <class Indice>
+static uint64_t exactCoverageGain(const vector<TicketNodeT<Indice> >& ticket_nodes,
+                                  const vector<MatchNodeT<Indice> >& garantias_nodes,
+                                  uint64_t ticket_idx, MarcasNivel2& marcas)
+{
+	uint32_t epoca = marcas.novaEpoca(ticket_nodes.size());
+	uint64_t ganho = 0;
+
+	const vector<Indice>& matches = ticket_nodes[ticket_idx].match_indexes;
+	for (size_t k = 0; k < matches.size(); ++k) {
+		const vector<Indice>& tickets = garantias_nodes[matches[k]].ticket_indexes;
+		for (size_t l = 0; l < tickets.size(); ++l) {
+			if (marcas.marcas[tickets[l]] == epoca) continue;
+			marcas.marcas[tickets[l]] = epoca;
+			if (!ticket_nodes[tickets[l]].is_covered) ++ganho;
+		}
+	}
+	return ganho;
+}
 
-						if (ticket_nodes[start_ticket_idx].match_indexes[k] == ticket_nodes[wheel_ticket_idxs[i]].match_indexes[j]) {
-							ticket_nodes[start_ticket_idx].remaining_coverage-= std::min<uint64_t>(ticket_nodes[start_ticket_idx].remaining_coverage, 1);
+/**
+ * Lazy (CELF-style) greedy. Coverage gains only ever decrease, so a gain
+ * computed earlier is an upper bound of the current one. Candidates sit in a
+ * max-heap keyed by that possibly stale bound; only the top one is re-evaluated
+ * exactly, and it is accepted as soon as its fresh gain is still no smaller
+ * than the next bound in the heap. No neighbour potentials are maintained, so
+ * there is no updatePotentials call per selection: selecting a ticket only
+ * marks the tickets it covers. remaining_coverage is not used.
+ *
+ * As in the default greedy, the first ticket is random (rank 0 with the
+ * symmetry on), ties are broken randomly, candidates sharing a match with the wheel are never accepted when
+ * permitirSobreposicao is 0, and the search stops past menorAposta tickets.
+ **/
+template <class Indice>
+static void generateWheelLazy(vector<TicketNodeT<Indice> >& ticket_nodes,
+                              const vector<MatchNodeT<Indice> >& garantias_nodes,
+                              vector<uint64_t>& wheel_ticket_idxs)
+{
+	std::mt19937_64 eng(novaSemente());
+	MarcasNivel2 marcas;
+	vector<bool> garantia_usada;
+	std::priority_queue<CandidatoLazy> candidatos;
+
+	if (permitirSobreposicao == 0)
+		garantia_usada.assign(garantias_nodes.size(), false);
+
+	// Antes da primeira selecao todo ticket cobre ele mesmo e todos os que
+	// dividem uma garantia com ele
+	uint64_t ganho_inicial = computeStartingCoverage(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos) + 1;
+	for (uint64_t ticket_idx = 0; ticket_idx < ticket_nodes.size(); ++ticket_idx) {
+		CandidatoLazy c;
+		c.ganho = ganho_inicial;
+		c.desempate = static_cast<uint32_t>(eng());
+		c.ticket_idx = ticket_idx;
+		candidatos.push(c);
+	}
 
-							foiCoberto=true;
-							break;
-						}
-					}
+	uint64_t start_ticket_idx = primeiroTicket(ticket_nodes.size(), eng);
 
-					if (foiCoberto)
-					 	break;
-				}
+	while (true) {
 
-				if (foiCoberto)
-				 	break;
+		wheel_ticket_idxs.push_back(start_ticket_idx);
+		if (abandonaTentativa(wheel_ticket_idxs))
+			return;
 
+		// Marca como cobertos o ticket escolhido e todos os que ele cobre
+		const vector<Indice>& matches = ticket_nodes[start_ticket_idx].match_indexes;
+		for (size_t k = 0; k < matches.size(); ++k) {
+			if (!garantia_usada.empty()) garantia_usada[matches[k]] = true;
+			const vector<Indice>& tickets = garantias_nodes[matches[k]].ticket_indexes;
+			for (size_t l = 0; l < tickets.size(); ++l)
+				ticket_nodes[tickets[l]].is_covered = 1;
+		}
+		ticket_nodes[start_ticket_idx].is_covered = 1;
+
+		bool achou = false;
+		while (!candidatos.empty()) {
+			CandidatoLazy topo = candidatos.top();
+			candidatos.pop();
+
+			if (!garantia_usada.empty()) {
+				bool sobrepoe = false;
+				const vector<Indice>& cand_matches = ticket_nodes[topo.ticket_idx].match_indexes;
+				for (size_t k = 0; k < cand_matches.size() && !sobrepoe; ++k)
+					sobrepoe = garantia_usada[cand_matches[k]];
+				if (sobrepoe) continue;
 			}
-			if (foiCoberto){
 
-				continue;
+			topo.ganho = exactCoverageGain(ticket_nodes, garantias_nodes, topo.ticket_idx, marcas);
+			INSTR_CONTA(INSTR_REAVALIACOES_LAZY);
+			if (topo.ganho == 0) continue;
+
+			if (candidatos.empty() || !(topo < candidatos.top())) {
+				start_ticket_idx = topo.ticket_idx;
+				achou = true;
+				break;
 			}
+			candidatos.push(topo);
+		}
+
+		if (!achou) {
+			cout << "Concluido." << endl;
+			return;
 		}
 	}
-	wheel_ticket_idxs.push_back(start_ticket_idx);
-    ticket_nodes[start_ticket_idx].remaining_coverage = 0;
-    ticket_nodes[start_ticket_idx].is_covered = 1;
+}
 
-    if( wheel_ticket_idxs.size() > menorAposta){
-      done = true;
-	  cout << "Concluido, ja possui uma cobertura igual menor." << endl;
-      break;
-    }
+/**
+ * Batched greedy. Each round scans for the maximal potential once and then
+ * takes, in random order, every tied ticket whose neighbourhood (the tickets
+ * it would cover, itself included) is disjoint from the neighbourhoods of the
+ * tickets already taken in the round, up to tamanhoLote tickets. Disjoint
+ * neighbourhoods mean selecting one of them leaves the potentials of the
+ * others untouched, so the round is exactly a sequence of ordinary greedy
+ * steps; only the argmax scans between them are saved.
+ *
+ * With permitirSobreposicao 0 a tied ticket sharing a match with the wheel is
+ * charged and skipped, as in the default greedy.
+ **/
+template <class Indice>
+static void generateWheelLote(vector<TicketNodeT<Indice> >& ticket_nodes,
+                              vector<MatchNodeT<Indice> >& garantias_nodes,
+                              vector<uint64_t>& wheel_ticket_idxs)
+{
+	std::mt19937_64 eng(novaSemente());
+	MarcasNivel2 marcas;
+	vector<bool> garantia_usada;
+	vector<uint64_t> best_coverage_ticket_idxs;
+	vector<uint64_t> lote;
 
-	updatePotentials(ticket_nodes, garantias_nodes, start_ticket_idx,total_coverage, one_pct);
-	//updateSimpleCovered( all_tickets,ticket_nodes,wheel_ticket_idxs,qtd_dez_garante_acertos );
+	if (permitirSobreposicao == 0)
+		garantia_usada.assign(garantias_nodes.size(), false);
 
-    //cout << "\t " << wheel_ticket_idxs.size() << " tickets selected for wheel." << endl;
-  }
+	lote.push_back(primeiroTicket(ticket_nodes.size(), eng));
 
-  //cout << "Done." << endl;
-}
-const std::string currentDateTime() {
-    time_t     now = time(0);
-    struct tm  tstruct;
-    char       buf[80];
-    tstruct = *localtime(&now);
-    // Visit http://en.cppreference.com/w/cpp/chrono/c/strftime
-    // for more information about date/time format
-    strftime(buf, sizeof(buf), "%d-%m-%Y_%Hh%Mmin%Sseg", &tstruct);
+	while (true) {
 
-    return buf;
-}
-std::string getCurrentDateTime() {
-    std::time_t t = std::time(nullptr);
-    std::tm tm = *std::localtime(&t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%d-%m-%Y_%Hh%Mmin%Sseg");
-    return oss.str();
-}
+		for (size_t i = 0; i < lote.size(); ++i) {
+			uint64_t ticket_idx = lote[i];
+			wheel_ticket_idxs.push_back(ticket_idx);
+			ticket_nodes[ticket_idx].remaining_coverage = 0;
+			ticket_nodes[ticket_idx].is_covered = 1;
 
-// Função para salvar apostasTotais em um arquivo .txt no formato desejado
-void saveApostasTotaisToFile(const std::vector<std::vector<int>>& apostasTotais,
-                             int qtd_dezenas_jogo, int qtd_dezenas_sorteio, int qtd_dez_garante_acertos) {
-    // Calcula a quantidade de jogos
-    size_t qtdNumeroJogo = apostasTotais.size();
+			if (abandonaTentativa(wheel_ticket_idxs))
+				return;
 
-    // Imprime informações sobre a quantidade de apostas e os intervalos
+			if (!garantia_usada.empty()) {
+				const vector<Indice>& matches = ticket_nodes[ticket_idx].match_indexes;
+				for (size_t k = 0; k < matches.size(); ++k)
+					garantia_usada[matches[k]] = true;
+			}
 
-    // Nome do arquivo com data e hora
-    std::string filename = "jogos_" + std::to_string(qtd_dezenas_jogo) +
-                           "_" + std::to_string(qtd_dezenas_sorteio) + "_"+std::to_string(qtd_dez_garante_acertos)+"_"
+			updatePotentials(ticket_nodes, garantias_nodes, ticket_idx);
+		}
+
+		if (findBestCoverageTickets(ticket_nodes, best_coverage_ticket_idxs) == 0) {
+			cout << "Concluido." << endl;
+			return;
+		}
+
+		// Embaralha o empate so ate onde for preciso, sorteando cada candidato
+		// entre os que ainda nao foram vistos
+		lote.clear();
+		uint32_t epoca = marcas.novaEpoca(ticket_nodes.size());
+		for (size_t i = 0; i < best_coverage_ticket_idxs.size() && lote.size() < tamanhoLote; ++i) {
+			std::swap(best_coverage_ticket_idxs[i], best_coverage_ticket_idxs[
+				std::uniform_int_distribution<size_t>(i, best_coverage_ticket_idxs.size() - 1)(eng)]);
+			uint64_t candidato = best_coverage_ticket_idxs[i];
+			const vector<Indice>& matches = ticket_nodes[candidato].match_indexes;
+
+			bool sobrepoe = false;
+			for (size_t k = 0; k < matches.size() && !sobrepoe; ++k)
+				sobrepoe = !garantia_usada.empty() && garantia_usada[matches[k]];
+			if (sobrepoe) {
+				ticket_nodes[candidato].remaining_coverage -= std::min<uint64_t>(ticket_nodes[candidato].remaining_coverage, 1);
+				continue;
+			}
+
+			bool interfere = false;
+			for (size_t k = 0; k < matches.size() && !interfere; ++k) {
+				const vector<Indice>& tickets = garantias_nodes[matches[k]].ticket_indexes;
+				for (size_t l = 0; l < tickets.size() && !interfere; ++l)
+					interfere = marcas.marcas[tickets[l]] == epoca;
+			}
+			if (interfere) continue;
+
+			for (size_t k = 0; k < matches.size(); ++k) {
+				const vector<Indice>& tickets = garantias_nodes[matches[k]].ticket_indexes;
+				for (size_t l = 0; l < tickets.size(); ++l)
+					marcas.marcas[tickets[l]] = epoca;
+			}
+			lote.push_back(candidato);
+		}
+
+		INSTR_CONTA(INSTR_RODADAS_LOTE);
+	}
+}
+
+/**
+ * Default greedy on an engine that keeps its own potentials (MotorFixo,
+ * MotorImplicito): seleciona() applies updatePotentials, melhores() is the
+ * argmax scan.
+ **/
+template <class Motor>
+static void generateWheelMotor(Motor& motor, uint64_t qtd_garantias, vector<uint64_t>& wheel_ticket_idxs)
+{
+	vector<bool> garantia_usada(permitirSobreposicao == 0 ? qtd_garantias : 0);
+
+	if (qtdThreads > 1 && (!pool_threads || pool_threads->tamanho() != qtdThreads))
+		pool_threads.reset(new PoolThreads(qtdThreads));
+	PoolThreads* pool = qtdThreads > 1 ? pool_threads.get() : NULL;
+
+	std::mt19937_64 eng(novaSemente());
+	vector<uint64_t> best_coverage_ticket_idxs;
+	uint64_t start_ticket_idx = primeiroTicket(motor.qtdTickets(), eng);
+
+	while (true) {
+
+		wheel_ticket_idxs.push_back(start_ticket_idx);
+		if (abandonaTentativa(wheel_ticket_idxs))
+			return;
+
+		motor.seleciona(start_ticket_idx, pool, limiarParalelo);
+		if (!garantia_usada.empty()) motor.marcaGarantias(start_ticket_idx, garantia_usada);
+
+		do {
+			if (motor.melhores(best_coverage_ticket_idxs) == 0) {
+				cout << "Concluido." << endl;
+				return;
+			}
+			start_ticket_idx = desempata(wheel_ticket_idxs, best_coverage_ticket_idxs, eng);
+			if (garantia_usada.empty() || !motor.sobrepoe(start_ticket_idx, garantia_usada))
+				break;
+			motor.cobra(start_ticket_idx);
+		} while (true);
+	}
+}
+
+/**
+ * Default greedy on the compile-time specialized engine. The generic nodes are
+ * copied into the fixed layout and released, so the engine does not double
+ * the memory of the search.
+ **/
+template <unsigned R, unsigned T, unsigned M>
+static void generateWheelFixo(vector<TicketNode>& ticket_nodes,
+                              vector<MatchNode>& garantias_nodes,
+                              vector<uint64_t>& wheel_ticket_idxs)
+{
+	MotorFixo<R, T, M> motor(ticket_nodes, garantias_nodes);
+	memRegistraEstrutura("motor_fixo", motor.bytes());
+	uint64_t qtd_garantias = garantias_nodes.size();
+	vector<TicketNode>().swap(ticket_nodes);
+	vector<MatchNode>().swap(garantias_nodes);
+
+	generateWheelMotor(motor, qtd_garantias, wheel_ticket_idxs);
+}
+
+/**
+ * Default greedy with no stored graph at all: only the potentials and coverage
+ * bits live in memory and every neighbour list is regenerated from ranks. For
+ * m = t - 1 the neighbours are single swaps and MotorTroca ranks them in O(1).
+ **/
+template <class Indice>
+static void generateWheelImplicito(std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                                   std::vector<uint64_t>& wheel_ticket_idxs)
+{
+	todas_garantias.clear();
+	todas_garantias.reserve(0);
+
+	if (motorGuloso != MOTOR_IMPLICITO && qtd_dez_garante_acertos + 1 == qtd_dezenas_sorteio) {
+		MotorTroca<Indice> motor(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+		memRegistraEstrutura("motor_troca", motor.bytes());
+		cout << "Gerando Roda da loteria..." << endl;
+		generateWheelMotor(motor, motor.qtdGarantias(), wheel_ticket_idxs);
+		return;
+	}
+
+	MotorImplicito<Indice> motor(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos);
+	memRegistraEstrutura("motor_implicito", motor.bytes());
+	cout << "Gerando Roda da loteria..." << endl;
+	generateWheelMotor(motor, motor.qtdGarantias(), wheel_ticket_idxs);
+}
+
+// Liga o despacho de despachaMotorFixo() ao generateWheelFixo da configuracao
+struct GulosoFixo
+{
+	vector<TicketNode>& ticket_nodes;
+	vector<MatchNode>& garantias_nodes;
+	vector<uint64_t>& wheel_ticket_idxs;
+	bool rodou;
+
+	template <unsigned R, unsigned T, unsigned M>
+	void executa()
+	{
+		if (MotorFixo<R, T, M>::compativel(ticket_nodes, garantias_nodes)) {
+			generateWheelFixo<R, T, M>(ticket_nodes, garantias_nodes, wheel_ticket_idxs);
+			rodou = true;
+		}
+	}
+};
+
+// O MotorFixo so existe para indices de 32 bits; devolve false quando nao
+// rodou. Quando roda ele consome os nos, entao a tentativa acaba nele mesmo
+// que volte vazia (cortada pelo prazo ou por sinal)
+static bool tentaMotorFixo(vector<TicketNode>& ticket_nodes, vector<MatchNode>& garantias_nodes,
+                           vector<uint64_t>& wheel_ticket_idxs)
+{
+	GulosoFixo guloso = { ticket_nodes, garantias_nodes, wheel_ticket_idxs, false };
+	despachaMotorFixo(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos, guloso);
+	return guloso.rodou;
+}
+
+static bool tentaMotorFixo(vector<TicketNode64>&, vector<MatchNode64>&, vector<uint64_t>&)
+{
+	return false;
+}
+
+/**
+ * updatePotentials over the on-disk graph: same two levels and the same
+ * charges, with potentials and coverage flags kept in memory. The adjacency
+ * list of a ticket is copied before its matches are read, since reading them
+ * may evict its shard, and the newly covered tickets are charged in rank
+ * order so that consecutive subtrees hit the same shards. Returns false if a
+ * shard could not be read back from disk.
+ **/
+template <class Indice>
+static bool updatePotentialsDisco(GrafoEmDisco<Indice>& grafo, vector<Indice>& remaining_coverage,
+                                  vector<uint8_t>& is_covered, uint64_t start_ticket_idx)
+{
+	size_t grau_ticket = grafo.grauTicket();
+	size_t grau_garantia = grafo.grauGarantia();
+	const Indice* lista = grafo.garantiasDoTicket(start_ticket_idx);
+	if (!lista)
+		return false;
+	vector<Indice> garantias(lista, lista + grau_ticket);
+
+	novos_cobertos.clear();
+	for (size_t i = 0; i < grau_ticket; ++i) {
+		const Indice* level1_tickets = grafo.ticketsDaGarantia(garantias[i]);
+		if (!level1_tickets)
+			return false;
+		for (size_t j = 0; j < grau_garantia; ++j) {
+			Indice u = level1_tickets[j];
+			remaining_coverage[u] -= std::min<Indice>(remaining_coverage[u], 1);
+			if (is_covered[u])
+				continue;
+			is_covered[u] = 1;
+			remaining_coverage[u] -= std::min<Indice>(remaining_coverage[u], 1);
+			novos_cobertos.push_back(u);
+		}
+	}
+
+	INSTR_SOMA(INSTR_TICKETS_NIVEL1, novos_cobertos.size());
+	std::sort(novos_cobertos.begin(), novos_cobertos.end());
+
+	for (size_t n = 0; n < novos_cobertos.size(); ++n) {
+		uint64_t level1_idx = novos_cobertos[n];
+		uint32_t epoca = marcas_serial.novaEpoca(remaining_coverage.size());
+		marcas_serial.marcas[level1_idx] = epoca;
+
+		lista = grafo.garantiasDoTicket(level1_idx);
+		if (!lista)
+			return false;
+		garantias.assign(lista, lista + grau_ticket);
+		for (size_t k = 0; k < grau_ticket; ++k) {
+			const Indice* level2_tickets = grafo.ticketsDaGarantia(garantias[k]);
+			if (!level2_tickets)
+				return false;
+			for (size_t l = 0; l < grau_garantia; ++l) {
+				Indice w = level2_tickets[l];
+				if (marcas_serial.marcas[w] == epoca)
+					continue;
+				marcas_serial.marcas[w] = epoca;
+				remaining_coverage[w] -= std::min<Indice>(remaining_coverage[w], 1);
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Default greedy over a GrafoEmDisco, for instances whose node graph does not
+ * fit in memory. The graph files are built on the first call and kept for the
+ * following searches; only the potentials live in memory. The level-2 charges
+ * are serial here, the threads would only contend for the shard cache.
+ **/
+template <class Indice>
+static void generateWheelDisco(std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                               std::vector<uint64_t>& wheel_ticket_idxs)
+{
+	unique_ptr<GrafoEmDisco<Indice> >& grafo = CopiaGrafoDisco<Indice>::grafo;
+	todas_garantias.clear();
+	todas_garantias.reserve(0);
+
+	if (!grafo) {
+		INSTR_FASE(fase_grafo, "grafo_disco");
+		cout << "Gravando o grafo em " << dirGrafoDisco << "...";
+		cout.flush();
+		grafo.reset(new GrafoEmDisco<Indice>(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos,
+		                                     dirGrafoDisco, bytesCacheGrafoDisco, bytesShardGrafoDisco));
+		if (!grafo->constroi()) {
+			cerr << "Nao foi possivel gravar o grafo em " << dirGrafoDisco << "." << endl;
+			grafo.reset();
+			return;
+		}
+		cout << "done. (" << (grafo->bytesEmDisco() >> 20) << " MB em disco, cache de "
+		     << (grafo->bytesCache() >> 20) << " MB)" << endl;
+		memRegistraEstrutura("grafo_disco_cache", grafo->bytesCache());
+		INSTR_FASE_ENCERRA(fase_grafo);
+	}
+
+	uint64_t qtd = grafo->qtdTickets();
+#ifndef RODALOTERIA_SEM_INSTRUMENTACAO
+	// So o relatorio usa as leituras desta tentativa
+	uint64_t lidos = grafo->shardsLidos(), acertos = grafo->acertosCache();
+#endif
+	vector<Indice> remaining_coverage(qtd, computeStartingCoverage(qtd_dezenas_jogo, qtd_dezenas_sorteio,
+	                                                              qtd_dez_garante_acertos));
+	vector<uint8_t> is_covered(qtd, 0);
+	vector<bool> garantia_usada(permitirSobreposicao == 0 ? grafo->qtdGarantias() : 0);
+	memRegistraEstrutura("potenciais_disco", qtd * (sizeof(Indice) + 1 + sizeof(uint32_t)));
+
+	std::mt19937_64 eng(novaSemente());
+	vector<uint64_t> best_coverage_ticket_idxs;
+	uint64_t start_ticket_idx = primeiroTicket(qtd, eng);
+	bool lido = true;
+
+	cout << "Gerando Roda da loteria..." << endl;
+	while (true) {
+
+		wheel_ticket_idxs.push_back(start_ticket_idx);
+		if (abandonaTentativa(wheel_ticket_idxs))
+			break;
+
+		remaining_coverage[start_ticket_idx] = 0;
+		is_covered[start_ticket_idx] = 1;
+		bool leu = updatePotentialsDisco(*grafo, remaining_coverage, is_covered, start_ticket_idx);
+		if (leu && !garantia_usada.empty()) {
+			const Indice* gs = grafo->garantiasDoTicket(start_ticket_idx);
+			leu = gs != NULL;
+			for (size_t k = 0; leu && k < grafo->grauTicket(); ++k) garantia_usada[gs[k]] = true;
+		}
+		if (!leu) {
+			lido = false;
+			break;
+		}
+
+		bool concluido = false;
+		while (true) {
+			uint64_t best_coverage_sz = 0;
+			best_coverage_ticket_idxs.clear();
+			INSTR_CONTA(INSTR_VARREDURAS_SELECAO);
+			for (uint64_t i = 0; i < qtd; ++i) {
+				if (remaining_coverage[i] > best_coverage_sz) {
+					best_coverage_ticket_idxs.clear();
+					best_coverage_sz = remaining_coverage[i];
+				}
+				if (remaining_coverage[i] == best_coverage_sz)
+					best_coverage_ticket_idxs.push_back(i);
+			}
+			if (best_coverage_sz == 0) {
+				concluido = true;
+				break;
+			}
+			start_ticket_idx = desempata(wheel_ticket_idxs, best_coverage_ticket_idxs, eng);
+			if (garantia_usada.empty())
+				break;
+
+			bool sobrepoe = false;
+			const Indice* gs = grafo->garantiasDoTicket(start_ticket_idx);
+			if (!gs) {
+				lido = false;
+				break;
+			}
+			for (size_t k = 0; k < grafo->grauTicket() && !sobrepoe; ++k) sobrepoe = garantia_usada[gs[k]];
+			if (!sobrepoe)
+				break;
+			remaining_coverage[start_ticket_idx] -= std::min<Indice>(remaining_coverage[start_ticket_idx], 1);
+		}
+		if (!lido)
+			break;
+		if (concluido) {
+			cout << "Concluido." << endl;
+			break;
+		}
+	}
+
+#ifndef RODALOTERIA_SEM_INSTRUMENTACAO
+	INSTR_SOMA(INSTR_SHARDS_LIDOS, grafo->shardsLidos() - lidos);
+	INSTR_SOMA(INSTR_SHARDS_ACERTOS, grafo->acertosCache() - acertos);
+#endif
+	if (!lido) {
+		// Tentativa perdida; a proxima grava o grafo de novo
+		cerr << "Nao foi possivel ler o grafo em " << dirGrafoDisco << "." << endl;
+		wheel_ticket_idxs.clear();
+		grafo.reset();
+	}
+}
+
+/**
+ * Generates a lottery wheel in a naiively greedy manner by continually
+ * selecting the ticket with the largest remaining coverage potential, until the
+ * largest remaining coverage potential is zero.
+ **/
+
+template <class Indice>
+static void generateWheelNos(std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                             std::vector<uint64_t>& wheel_ticket_idxs)
+{
+  vector<TicketNodeT<Indice> > ticket_nodes;
+  vector<MatchNodeT<Indice> > garantias_nodes;
+  vector<TicketNodeT<Indice> >& ticket_nodes_cp = CopiaNos<Indice>::tickets;
+  vector<MatchNodeT<Indice> >& garantias_nodes_cp = CopiaNos<Indice>::garantias;
+
+  bool is_first_iteration = true;
+  bool done = false;
+
+  if (ticket_nodes_cp.empty()){
+	{
+	// O universo so fica vivo aqui se mais alguem o estiver usando
+	std::shared_ptr<const UniversoTickets> universo = UniversoTickets::obtem(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+  	generateNodes(universo->tickets(), todas_garantias, ticket_nodes, garantias_nodes);
+	}
+	if(qtdBusca > 1 || manterGrafo){
+		ticket_nodes_cp = ticket_nodes;
+		garantias_nodes_cp =  garantias_nodes;
+		memRegistraEstrutura("ticket_nodes_cp", memBytes(ticket_nodes_cp));
+		memRegistraEstrutura("garantias_nodes_cp", memBytes(garantias_nodes_cp));
+		}
+  }else{
+	ticket_nodes = ticket_nodes_cp;
+	garantias_nodes = garantias_nodes_cp;
+  }
+
+  cout << "Gerando Roda da loteria..." << endl;
+
+  if (modoGuloso == GULOSO_PREGUICOSO) {
+    generateWheelLazy(ticket_nodes, garantias_nodes, wheel_ticket_idxs);
+    return;
+  }
+  if (modoGuloso == GULOSO_LOTE) {
+    generateWheelLote(ticket_nodes, garantias_nodes, wheel_ticket_idxs);
+    return;
+  }
+  if (motorGuloso != MOTOR_GENERICO && tentaMotorFixo(ticket_nodes, garantias_nodes, wheel_ticket_idxs))
+    return;
+
+  while (!done) {
+
+    uint64_t start_ticket_idx;
+
+    if (is_first_iteration) {
+
+     std::mt19937_64 eng(novaSemente());
+	  start_ticket_idx = primeiroTicket(ticket_nodes.size(), eng);
+
+	  is_first_iteration = false;
+
+    } else {
+
+      start_ticket_idx = 0;
+
+      vector<uint64_t> best_coverage_ticket_idxs;
+      uint64_t best_coverage_sz = findBestCoverageTickets(ticket_nodes, best_coverage_ticket_idxs);
+
+      // cout << "\t Next best coverage is " << best_coverage_sz << " (by "
+      //      << best_coverage_ticket_idxs.size() << " tickets)" << endl;
+
+      if (best_coverage_sz == 0) {
+        done = true;
+		cout << "Concluido." << endl;
+        break;
+      }
+
+      // If more than one ticket has maximal coverage potential, select randomly
+      // from among the set that do.
+	  std::mt19937_64 eng(novaSemente());
+	  start_ticket_idx = desempata(wheel_ticket_idxs, best_coverage_ticket_idxs, eng);
+
+		if(permitirSobreposicao==0){
+			bool foiCoberto = false;
+
+			for (int i=0; i< wheel_ticket_idxs.size();++i){
+
+				for (int j =0;  j < ticket_nodes[wheel_ticket_idxs[i]].match_indexes.size(); ++j){
+
+					for (int k = 0; k < ticket_nodes[start_ticket_idx].match_indexes.size(); ++k){
+
+						if (ticket_nodes[start_ticket_idx].match_indexes[k] == ticket_nodes[wheel_ticket_idxs[i]].match_indexes[j]) {
+							ticket_nodes[start_ticket_idx].remaining_coverage-= std::min<uint64_t>(ticket_nodes[start_ticket_idx].remaining_coverage, 1);
+
+							foiCoberto=true;
+							break;
+						}
+					}
+
+					if (foiCoberto)
+					 	break;
+				}
+
+				if (foiCoberto)
+				 	break;
+
+			}
+			if (foiCoberto){
+
+				continue;
+			}
+		}
+	}
+	wheel_ticket_idxs.push_back(start_ticket_idx);
+    ticket_nodes[start_ticket_idx].remaining_coverage = 0;
+    ticket_nodes[start_ticket_idx].is_covered = 1;
+
+    if (abandonaTentativa(wheel_ticket_idxs)) {
+      done = true;
+      break;
+    }
+
+	updatePotentials(ticket_nodes, garantias_nodes, start_ticket_idx);
+
+    //cout << "\t " << wheel_ticket_idxs.size() << " tickets selected for wheel." << endl;
+  }
+
+  //cout << "Done." << endl;
+}
+
+/**
+ * Picks the node index width for the current problem: 32 bits whenever the
+ * ticket and match counts fit (denser nodes, and the only width MotorFixo
+ * has), 64 bits otherwise. The engines of motorSemGrafo() do not store the
+ * graph at all, and with --grafo-disco it is kept on disk.
+ **/
+static void generateWheelMotorEscolhido(std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                                       std::vector<uint64_t>& wheel_ticket_idxs)
+{
+  bool estreito = indices32Bits(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos);
+  if (motorSemGrafo()) {
+    if (estreito) generateWheelImplicito<uint32_t>(todas_garantias, wheel_ticket_idxs);
+    else generateWheelImplicito<uint64_t>(todas_garantias, wheel_ticket_idxs);
+    return;
+  }
+  if (!dirGrafoDisco.empty()) {
+    if (estreito) generateWheelDisco<uint32_t>(todas_garantias, wheel_ticket_idxs);
+    else generateWheelDisco<uint64_t>(todas_garantias, wheel_ticket_idxs);
+    return;
+  }
+  if (estreito)
+    generateWheelNos<uint32_t>(todas_garantias, wheel_ticket_idxs);
+  else
+    generateWheelNos<uint64_t>(todas_garantias, wheel_ticket_idxs);
+}
+
+/**
+ * Runs one greedy attempt and records the symmetry classes of its first
+ * tickets, so that later attempts steer away from them.
+ **/
+void generateWheel(std::vector<boost::dynamic_bitset<>>& todas_garantias,
+                   std::vector<uint64_t>& wheel_ticket_idxs)
+{
+  generateWheelMotorEscolhido(todas_garantias, wheel_ticket_idxs);
+  if (profundidadeSimetria > 1 && prefixosExplorados().registra(wheel_ticket_idxs))
+    INSTR_CONTA(INSTR_PREFIXOS_REPETIDOS);
+}
+
+// Versoes do motor generico usadas fora deste arquivo (benchmark)
+#define INSTANCIA_MOTOR_GENERICO(Indice) \
+  template void generateNodes<Indice>(const vector<boost::dynamic_bitset<> >&, vector<boost::dynamic_bitset<> >&, \
+                                      vector<TicketNodeT<Indice> >&, vector<MatchNodeT<Indice> >&); \
+  template void updatePotentials<Indice>(vector<TicketNodeT<Indice> >&, vector<MatchNodeT<Indice> >&, \
+                                         uint64_t); \
+  template void updatePotentialsDFS<Indice>(vector<TicketNodeT<Indice> >&, vector<MatchNodeT<Indice> >&, \
+                                            uint64_t); \
+  template uint64_t findBestCoverageTickets<Indice>(const vector<TicketNodeT<Indice> >&, vector<uint64_t>&);
+
+INSTANCIA_MOTOR_GENERICO(uint32_t)
+INSTANCIA_MOTOR_GENERICO(uint64_t)
+
+const std::string currentDateTime() {
+    time_t     now = time(0);
+    struct tm  tstruct;
+    char       buf[80];
+    tstruct = *localtime(&now);
+    // Visit http://en.cppreference.com/w/cpp/chrono/c/strftime
+    // for more information about date/time format
+    strftime(buf, sizeof(buf), "%d-%m-%Y_%Hh%Mmin%Sseg", &tstruct);
+
+    return buf;
+}
+// Chamada tambem das threads de acabaTrabalho: localtime_r, ja que o
+// localtime divide o buffer entre as threads (no msvcrt ele ja e por thread)
+std::string getCurrentDateTime() {
+    std::time_t t = std::time(nullptr);
+    std::tm tm;
+#ifdef _WIN32
+    tm = *std::localtime(&t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%d-%m-%Y_%Hh%Mmin%Sseg");
+    return oss.str();
+}
+
+// Função para salvar apostasTotais em um arquivo .txt no formato desejado
+void saveApostasTotaisToFile(const std::vector<std::vector<int>>& apostasTotais,
+                             int qtd_dezenas_jogo, int qtd_dezenas_sorteio, int qtd_dez_garante_acertos) {
+    // Calcula a quantidade de jogos
+    size_t qtdNumeroJogo = apostasTotais.size();
+
+    // Imprime informações sobre a quantidade de apostas e os intervalos
+
+    // Nome do arquivo com data e hora
+    std::string filename = "jogos_" + std::to_string(qtd_dezenas_jogo) +
+                           "_" + std::to_string(qtd_dezenas_sorteio) + "_"+std::to_string(qtd_dez_garante_acertos)+"_"+
                            std::to_string(qtdNumeroJogo) + "_" + getCurrentDateTime() + ".txt";
 
+    if (gravaApostasArquivo(apostasTotais, filename))
+        std::cout << "Dados gravados com sucesso no arquivo: " << filename << std::endl;
+}
+
+// Grava as apostas no arquivo indicado, uma aposta por linha separada por ';'
+bool gravaApostasArquivo(const std::vector<std::vector<int>>& apostasTotais,
+                         const std::string& filename) {
     // Abre o arquivo para escrita
     std::ofstream outFile(filename);
 
     if (!outFile) {
         std::cerr << "Não foi possível abrir o arquivo para gravação." << std::endl;
-        return;
+        return false;
     }
 
     // Grava o conteúdo de apostasTotais no arquivo
@@ -647,7 +1681,7 @@ void saveApostasTotaisToFile(const std::vector<std::vector<int>>& apostasTotais,
     }
 
     outFile.close();
-    std::cout << "Dados gravados com sucesso no arquivo: " << filename << std::endl;
+    return true;
 }
 void eliminaNumPosicao(std::vector<std::vector<int>>& jogosGerados) {
     std::vector<int> listaRemove;
@@ -801,183 +1835,1522 @@ std::vector<std::vector<int>> obter_resultados(const std::string& nomeArquivo) {
 }
 
 
+// Liga o despacho de despachaMascara() a remove15E14Num
+struct RemoveAcertos14
+{
+	const std::vector<std::vector<int>>& resultSorteio;
+	std::vector<std::vector<int>>& jogosGerados;
+	size_t dezenas;
+
+	template <class M>
+	void executa()
+	{
+		std::vector<M> resultados(resultSorteio.size());
+		unsigned maior_resultado = 0;
+		for (size_t i = 0; i < resultSorteio.size(); ++i) {
+			resultados[i] = mascaraDeDezenas<M>(resultSorteio[i]);
+			maior_resultado = std::max(maior_resultado, mascaraContaBits(resultados[i]));
+		}
+
+		unsigned maior_jogo = 0;
+		for (size_t j = 0; j < jogosGerados.size(); ++j)
+			maior_jogo = std::max<unsigned>(maior_jogo, jogosGerados[j].size());
+		// Quem tem 14 em comum com um resultado dista no maximo |resultado| + |jogo| - 28 dele
+		size_t raio_max = maior_resultado + maior_jogo > 28 ? maior_resultado + maior_jogo - 28 : 0;
+		IndiceHamming<M> indice(dezenas, raio_max + 1);
+		for (size_t j = 0; j < jogosGerados.size(); ++j)
+			indice.insere(mascaraDeDezenas<M>(jogosGerados[j]));
+
+		std::vector<bool> remove(jogosGerados.size(), false);
+		for (size_t i = 0; i < resultados.size(); ++i) {
+			const M& resultado = resultados[i];
+			unsigned tamanho = mascaraContaBits(resultado);
+			size_t raio = tamanho + indice.maiorJogo() > 28 ? tamanho + indice.maiorJogo() - 28 : 0;
+			indice.vizinhos(resultado, raio, [&](uint32_t id, unsigned d) {
+				if (d == 0 || mascaraContaComuns(resultado, indice.mascara(id)) == 14) remove[id] = true;
+			});
+		}
+
+		size_t fica = 0;
+		for (size_t j = 0; j < jogosGerados.size(); ++j)
+			if (!remove[j]) jogosGerados[fica++].swap(jogosGerados[j]);
+		jogosGerados.resize(fica);
+	}
+};
+
+/**
+ * Remove os jogos que repetem um resultado ou acertam 14 dezenas dele. Os
+ * jogos vao para um IndiceHamming e cada resultado so confere os que estao no
+ * raio de 14 acertos, no lugar de comparar todos com todos.
+ **/
 void remove15E14Num( const std::vector<std::vector<int>>& resultSorteio, std::vector<std::vector<int>>& jogosGerados) {
-    std::set<int> listaRemove;
-
-    for (size_t i = 0; i < resultSorteio.size(); ++i) {
-        int cont = 0;
-
-        for (const auto& j : jogosGerados) {
-            if (listaRemove.find(cont) == listaRemove.end()) {
-                if (resultSorteio[i] == j) {
-                    listaRemove.insert(cont);
-                } else {
-                    // Calcula a interseção dos conjuntos
-                    std::vector<int> intersection;
-                    std::set_intersection(resultSorteio[i].begin(), resultSorteio[i].end(),
-                                          j.begin(), j.end(),
-                                          std::back_inserter(intersection));
-                    if (intersection.size() == 14) {
-                        listaRemove.insert(cont);
-                    }
-                }
-            }
-            cont++;
-        }
-    }
+    int maior_dezena = 0;
+    for (size_t i = 0; i < resultSorteio.size(); ++i)
+        for (size_t k = 0; k < resultSorteio[i].size(); ++k) maior_dezena = std::max(maior_dezena, resultSorteio[i][k]);
+    for (size_t j = 0; j < jogosGerados.size(); ++j)
+        for (size_t k = 0; k < jogosGerados[j].size(); ++k) maior_dezena = std::max(maior_dezena, jogosGerados[j][k]);
+
+    RemoveAcertos14 remove = { resultSorteio, jogosGerados, static_cast<size_t>(maior_dezena) + 1 };
+    if (!despachaMascara(remove.dezenas, remove))
+        cerr << "remove15E14Num: dezena " << maior_dezena << " fora do alcance das mascaras" << endl;
+}
 
-    // Remove os elementos da lista `jogosGerados`
-    for (auto it = listaRemove.rbegin(); it != listaRemove.rend(); ++it) {
-        jogosGerados.erase(jogosGerados.begin() + *it);
+/**
+ * Le a especificacao de filtros: "padrao" (resultados,gap:5,posicao,sequencia:8,
+ * os de sempre), "nenhum", ou a lista separada por virgula de resultados,
+ * gap:N, posicao e sequencia:N, aplicados na ordem dada.
+ **/
+static bool interpretaFiltros(const std::string& filtros, std::vector<std::pair<std::string, int> >& passos)
+{
+    std::string lista = filtros == "padrao" ? "resultados,gap:5,posicao,sequencia:8" : filtros;
+    passos.clear();
+    if (lista == "nenhum") return true;
+    std::stringstream ss(lista);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t dois_pontos = item.find(':');
+        std::string nome = item.substr(0, dois_pontos);
+        int valor = dois_pontos == std::string::npos ? 0 : atoi(item.c_str() + dois_pontos + 1);
+        bool com_valor = nome == "gap" || nome == "sequencia";
+        if ((nome != "resultados" && nome != "posicao" && !com_valor) || (com_valor != (dois_pontos != std::string::npos)))
+            return false;
+        passos.push_back(std::make_pair(nome, valor));
     }
+    return !passos.empty();
 }
 
+bool filtrosValidos(const std::string& filtros)
+{
+    std::vector<std::pair<std::string, int> > passos;
+    return interpretaFiltros(filtros, passos);
+}
 
-int main(int argc, char *argv[])
+void aplicaFiltros(const std::string& filtros, const std::vector<std::vector<int>>& resultSorteio,
+                   std::vector<std::vector<int>>& jogosGerados)
 {
-	std::vector<boost::dynamic_bitset<>> all_tickets;
-	std::vector<boost::dynamic_bitset<>> todas_garantias;
+    std::vector<std::pair<std::string, int> > passos;
+    interpretaFiltros(filtros, passos);
+    for (size_t i = 0; i < passos.size(); ++i) {
+        if (passos[i].first == "resultados") remove15E14Num(resultSorteio, jogosGerados);
+        else if (passos[i].first == "gap") eliminaMaiorGap(passos[i].second, jogosGerados);
+        else if (passos[i].first == "posicao") eliminaNumPosicao(jogosGerados);
+        else eliminaNumSequencia(passos[i].second, jogosGerados);
+    }
+}
 
-  	qtdBusca=0;
-	int qtdArgc = 7;
-  if (argc ==qtdArgc)	qtd_dezenas_jogo = atoi(argv[1]);
-  else{
-	  cout << "Digite quantidade de dezenas da loteria: ";
-	  cin >> qtd_dezenas_jogo;
-	}
-
-  if (qtd_dezenas_jogo > 64) {
-    cerr << "Ranges larger than 64 are not supported." << endl;
-    return -1;
-  }
-  if (argc ==qtdArgc)
-  	qtd_dezenas_sorteio = atoi(argv[2]);
-  else{
 
-	  cout << "digite quantidade de dezenas sorteadas: ";
-	  cin >> qtd_dezenas_sorteio;
+#ifndef RODALOTERIA_SEM_MAIN
+/**
+ * Separa as opcoes nomeadas (--nome valor, --nome=valor ou so --nome) dos
+ * parametros posicionais, que continuam na ordem de sempre.
+ **/
+static void separaOpcoes(int argc, char *argv[], vector<string>& args,
+                         unordered_map<string, string>& opcoes)
+{
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg.compare(0, 2, "--") != 0) {
+			args.push_back(arg);
+			continue;
+		}
+		size_t igual = arg.find('=');
+		if (igual != string::npos)
+			opcoes[arg.substr(2, igual - 2)] = arg.substr(igual + 1);
+		else if (i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0)
+			opcoes[arg.substr(2)] = argv[++i];
+		else
+			opcoes[arg.substr(2)] = "1";
 	}
+}
 
-  if (qtd_dezenas_sorteio > qtd_dezenas_jogo) {
+/**
+ * Confere (r, t, m) contra o universo e os limites do gerador, com as
+ * mensagens de sempre em cerr.
+ **/
+static bool parametrosValidos(size_t r, size_t t, size_t m, size_t universo)
+{
+  if (r > MASCARA_MAX_DEZENAS) {
+    cerr << "Ranges larger than " << MASCARA_MAX_DEZENAS << " are not supported." << endl;
+    return false;
+  }
+  if (r > universo) {
+    cerr << "Range (" << r << ") cannot be larger than the universe (" << universo
+         << "); use --universo N." << endl;
+    return false;
+  }
+  if (t > r) {
     cerr << "Ticket size cannot be larger than range (that makes no sense!)" << endl;
-    return -1;
-  } else if ( comb(qtd_dezenas_jogo, qtd_dezenas_sorteio) >= (1ul << 30) ) {
+    return false;
+  } else if ( binomial(r, t) >= (UINT64_C(1) << 63) ) {
+    // Com indices de 64 bits o limite e o do contador de cobertura (63 bits);
+    // antes disso quem para a execucao e a previsao de memoria
     cerr << "This combination of range and ticket size would generate too many tickets ("
-         << comb(qtd_dezenas_jogo, qtd_dezenas_sorteio) << ")." << endl;
-    cerr << "This program only supports quantities of tickets less than 2^30 ("
-         << (1ul << 30) << ")." << endl;
-    return -1;
+         << binomial(r, t) << ")." << endl;
+    cerr << "This program only supports quantities of tickets less than 2^63." << endl;
+    return false;
   }
-    if (argc ==qtdArgc)	qtd_dez_garante_acertos = atoi(argv[3]);
-	else{
+  if (m > t) {
+    cerr << "Match size cannot be larger than ticket size (that makes no sense!)" << endl;
+    return false;
+  } else if (m > 16) {
+    cerr << "Match sizes larger than 16 are not supported." << endl;
+    return false;
+  } else if (motorGuloso == MOTOR_TROCA && m + 1 != t) {
+    cerr << "O motor de trocas so serve para garantia = dezenas sorteadas - 1." << endl;
+    return false;
+  }
+  return true;
+}
 
-		cout << "digite quantidade de dezenas da  garantia: ";
-		cin >> qtd_dez_garante_acertos;
-	}
-    //  qtd_dez_garante_acertos = 2;
-	  if (qtd_dez_garante_acertos > qtd_dezenas_sorteio) {
-	    cerr << "Match size cannot be larger than ticket size (that makes no sense!)" << endl;
-	    return -1;
-	  } else if (qtd_dez_garante_acertos > 16) {
-	    cerr << "Match sizes larger than 16 are not supported." << endl;
-	    return -1;
-	  }
-	if (argc ==qtdArgc)qtdBusca = atoi(argv[4]);
-	else{
-		cout << "Entre com quantidade de tentativas de buscas: ";
-		cin >> qtdBusca;
+// O que os trabalhos de uma execucao dividem entre si
+struct RecursosTrabalho
+{
+	BibliotecaRodas biblioteca;
+	std::vector<std::vector<int>> resultados;        ///< sorteios anteriores, para o filtro "resultados"
+	bool tem_orcamento;
+	uint64_t orcamento;                              ///< --orcamento-memoria, em bytes
+	std::shared_ptr<const UniversoTickets> universo; ///< segura os tickets entre trabalhos de mesmo (r, t)
+	std::mutex trava_biblioteca;                     ///< o modo servidor le a biblioteca durante as buscas
+	string arquivo_checkpoint;                       ///< --checkpoint (CheckpointBusca.h); vazio = sem
+	double periodo_checkpoint;                       ///< --checkpoint-s, segundos entre checkpoints
+	bool retoma;                                     ///< --retoma: comeca do checkpoint
+
+	explicit RecursosTrabalho(const string& arquivo_biblioteca)
+		: biblioteca(arquivo_biblioteca), tem_orcamento(false), orcamento(0), periodo_checkpoint(60), retoma(false) {}
+};
+
+// Passa o trabalho para os parametros globais do problema
+static void defineTrabalho(const TrabalhoRoda& trabalho)
+{
+	qtd_dezenas_jogo = trabalho.r;
+	qtd_dezenas_sorteio = trabalho.t;
+	qtd_dez_garante_acertos = trabalho.m;
+	// Com prazo e buscas 0, tenta enquanto houver tempo
+	qtdBusca = trabalho.tempo > 0 && trabalho.buscas == 0 ? SIZE_MAX : trabalho.buscas;
+	permitirSobreposicao = trabalho.sobreposicao;
+	qtd_jogos = trabalho.jogos;
+	defineSemente(trabalho.semente);
+	PrazoBusca::inicia(trabalho.tempo);
+}
+
+/**
+ * Previsao de memoria antes de alocar qualquer estrutura grande; com
+ * --orcamento-memoria <MB> devolve false se nao couber (com --grafo-disco o
+ * orcamento limita o cache de shards)
+ **/
+static bool previsaoCabe(const RecursosTrabalho& recursos)
+{
+	PrevisaoMemoria previsao = memPreve(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos, qtdBusca);
+	memImprimePrevisao(cout, previsao);
+	cout << "Indices dos nos: " << (indices32Bits(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos) ? 32 : 64)
+	     << " bits" << endl;
+	if (recursos.tem_orcamento) {
+		uint64_t orcamento = recursos.orcamento;
+		if (!dirGrafoDisco.empty()) {
+			// Com o grafo em disco o orcamento vira o teto do cache de shards,
+			// descontados os potenciais que ficam em memoria
+			uint64_t fixo = comb(qtd_dezenas_jogo, qtd_dezenas_sorteio) * (sizeof(uint64_t) + 1 + sizeof(uint32_t));
+			bytesCacheGrafoDisco = orcamento > fixo ? orcamento - fixo : 0;
+		} else if (previsao.pico > orcamento && !motorSemGrafo()) {
+			cerr << "A previsao de memoria (" << (previsao.pico >> 20) << " MB) excede o orcamento de "
+			     << (orcamento >> 20) << " MB; use --grafo-disco <dir> para manter o grafo em disco." << endl;
+			return false;
+		}
 	}
-	if (argc ==qtdArgc)permitirSobreposicao = atoi(argv[5]);
-	else{
-		cout << "permitir sobreposicao, digite 1 para sim 0 para nao: ";
-		cin >> permitirSobreposicao;
+	if (motorSemGrafo())
+		cout << "Motor sem grafo: ~" << ((comb(qtd_dezenas_jogo, qtd_dezenas_sorteio) * sizeof(uint64_t)) >> 20)
+		     << " MB" << endl;
+	else if (!dirGrafoDisco.empty())
+		cout << "Grafo em disco (" << dirGrafoDisco << "), cache de ate " << (bytesCacheGrafoDisco >> 20)
+		     << " MB" << endl;
+	return true;
+}
+
+// Tickets da roda (ranks de generateAllCombos) em dezenas de 1 a r
+static void rodaDosRanks(const vector<uint64_t>& ranks, size_t r, size_t t, BibliotecaRodas::Roda& roda)
+{
+	roda.clear();
+	boost::dynamic_bitset<> ticket;
+	for (size_t k = 0; k < ranks.size(); ++k) {
+		unrankCombinacao(ranks[k], r, t, ticket);
+		roda.push_back(convertBitsetNum(ticket));
 	}
-	if (argc ==qtdArgc)qtd_jogos = atoi(argv[6]);
-	else{
-		cout << "Digite a quantidades de jogos: ";
-		cin >> qtd_jogos;
+}
+
+/**
+ * Acrescenta aos ranks os sorteios que a roda deixa descobertos
+ * (completaRoda); devolve quantos entraram, 0 se ela ja garantia m ou se r
+ * passa das mascaras.
+ **/
+static size_t completaRanks(vector<uint64_t>& ranks, size_t r, size_t t, size_t m)
+{
+	BibliotecaRodas::Roda roda, faltam;
+	rodaDosRanks(ranks, r, t, roda);
+	if (completaRoda(roda, r, t, m, faltam) == UINT64_MAX) return 0;
+	vector<size_t> posicoes(t);
+	for (size_t i = 0; i < faltam.size(); ++i) {
+		for (size_t k = 0; k < t; ++k) posicoes[k] = faltam[i][k] - 1;
+		ranks.push_back(rankPosicoes(posicoes.data(), t, r));
 	}
+	return faltam.size();
+}
 
-	vector<uint64_t> wheel_ticket_idxsCopy;
-	vector<uint64_t> wheel_ticket_idxs;
-	cout << "Gerar todos os tickets possiveis...";
-	cout.flush();
-	boost::dynamic_bitset<> dezenas_jogo(qtd_dezenas_jogo);
-	//gerar todos os tickets possiveis
-	generateAllCombos(dezenas_jogo,0,qtd_dezenas_sorteio, all_tickets);
-	cout << "done. (generated " << all_tickets.size() << " tickets)" << endl;
+/**
+ * Guarda a roda na biblioteca se ela for melhor que a de la e garantir m: uma
+ * roda incompleta no lugar de uma maior e completa seria reetiquetada em
+ * todos os jogos dali em diante. A conferencia passa por todos os sorteios e
+ * fica fora da trava.
+ **/
+static void guardaNaBiblioteca(RecursosTrabalho& recursos, size_t r, size_t t, size_t m, size_t sobreposicao,
+                               const BibliotecaRodas::Roda& roda)
+{
+	BibliotecaRodas& biblioteca = recursos.biblioteca;
+	if (biblioteca.nomeArquivo().empty() || roda.empty()) return;
+	{
+		std::lock_guard<std::mutex> guarda(recursos.trava_biblioteca);
+		const BibliotecaRodas::Roda* guardada = biblioteca.busca(r, t, m, sobreposicao);
+		if (guardada && guardada->size() <= roda.size()) return;
+	}
+	uint64_t descobertos = confereRoda(roda, r, t, m);
+	if (descobertos != 0) {
+		cerr << "Roda de " << roda.size() << " apostas fora da biblioteca: "
+		     << (descobertos == UINT64_MAX ? string("dezenas demais para conferir")
+		                                   : std::to_string(descobertos) + " sorteios descobertos") << endl;
+		return;
+	}
+	std::lock_guard<std::mutex> guarda(recursos.trava_biblioteca);
+	if (biblioteca.oferece(r, t, m, sobreposicao, roda)) {
+		if (biblioteca.grava())
+			cout << "Roda de " << roda.size() << " apostas guardada em " << biblioteca.nomeArquivo() << endl;
+		else
+			cerr << "Nao foi possivel gravar " << biblioteca.nomeArquivo() << endl;
+	}
+}
 
+// Garantias de generateWheel para a configuracao dos globais
+static void preparaGarantias(std::vector<boost::dynamic_bitset<>>& todas_garantias)
+{
+	INSTR_FASE(fase_enumera, "enumera");
+	// Os tickets ficam em UniversoTickets, montado so quando o motor generico
+	// indexa o grafo
 	cout << "Generating all possible " << qtd_dez_garante_acertos << "-garantia...";
 	cout.flush();
-	dezenas_jogo.reset();
-	//gerar todas garantias possiveis
-	generateAllCombos(dezenas_jogo, 0,qtd_dez_garante_acertos ,todas_garantias);
+	boost::dynamic_bitset<> dezenas_jogo(qtd_dezenas_jogo);
+	//gerar todas garantias possiveis (o grafo em disco e os motores sem grafo
+	//geram as suas sozinhos, um grafo guardado ja as tem e a indexacao pelo
+	//complemento so usa os ranks)
+	if (dirGrafoDisco.empty() && !motorSemGrafo() && !grafoGuardado() &&
+	    !usaComplemento(qtd_dezenas_jogo, qtd_dezenas_sorteio))
+		generateAllCombos(dezenas_jogo, 0,qtd_dez_garante_acertos ,todas_garantias);
 	cout << "done. (generated " << todas_garantias.size() << " "
 		<< qtd_dez_garante_acertos << "-combinacoes de garantia)" << endl;
-  	menorAposta=all_tickets.size();
-  for (size_t i=0;i< qtdBusca;i++){
+	memRegistraEstrutura("todas_garantias", memBytes(todas_garantias));
+	INSTR_FASE_ENCERRA(fase_enumera);
+}
 
-	generateWheel(all_tickets, todas_garantias, wheel_ticket_idxsCopy);
+/**
+ * Roda da configuracao dos globais, em dezenas de 1 a r. Parte da melhor roda
+ * conhecida na biblioteca (com ela as tentativas so ficam com uma roda menor,
+ * e sem tentativas a busca nem roda) e guarda na biblioteca a roda achada se
+ * ela for melhor.
+ **/
+static void buscaRoda(RecursosTrabalho& recursos, BibliotecaRodas::Roda& roda)
+{
+	BibliotecaRodas& biblioteca = recursos.biblioteca;
+	roda.clear();
+	{
+	std::lock_guard<std::mutex> guarda(recursos.trava_biblioteca);
+	const BibliotecaRodas::Roda* guardada = biblioteca.busca(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos,
+	                                                         permitirSobreposicao);
+	if (guardada) {
+		roda = *guardada;
+		cout << "Roda da biblioteca " << biblioteca.nomeArquivo() << ": " << roda.size() << " apostas" << endl;
+	}
+	}
 
-	if ( menorAposta > wheel_ticket_idxsCopy.size() ){
+	std::vector<boost::dynamic_bitset<>> todas_garantias;
+	vector<uint64_t> wheel_ticket_idxsCopy;
+	vector<uint64_t> wheel_ticket_idxs;
+	const string& arquivo_checkpoint = recursos.arquivo_checkpoint;
+	size_t feitas = 0;
+	if (recursos.retoma && !arquivo_checkpoint.empty()) {
+		EstadoBusca salvo;
+		if (!carregaEstadoBusca(arquivo_checkpoint, salvo))
+			cout << "Sem checkpoint em " << arquivo_checkpoint << "; a busca comeca do zero" << endl;
+		else if (!salvo.mesmaConfiguracao(qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos, permitirSobreposicao))
+			cerr << "O checkpoint " << arquivo_checkpoint << " e de outra configuracao; a busca comeca do zero" << endl;
+		else {
+			feitas = salvo.tentativas_feitas;
+			defineSemente(salvo.semente, salvo.sementes_usadas);
+			uint64_t qtd_tickets = comb(qtd_dezenas_jogo, qtd_dezenas_sorteio);
+			bool valida = true;
+			for (size_t k = 0; k < salvo.roda.size(); ++k) valida = valida && salvo.roda[k] < qtd_tickets;
+			if (valida && !salvo.roda.empty() && (roda.empty() || salvo.roda.size() < roda.size()))
+				wheel_ticket_idxs = salvo.roda;
+			cout << "Retomando de " << arquivo_checkpoint << ": " << feitas << " tentativas feitas, roda de "
+			     << salvo.roda.size() << " apostas" << endl;
+		}
+	}
+	bool tem_roda = !roda.empty() || !wheel_ticket_idxs.empty();
+	size_t tentativas = tem_roda ? qtdBusca : std::max<size_t>(qtdBusca, 1);
+	PrazoBusca::permiteCorte(tem_roda);
+
+	if (feitas < tentativas) {
+	// O checkpoint sai entre as tentativas, gravado por outra thread
+	unique_ptr<GravadorCheckpoint> gravador;
+	if (!arquivo_checkpoint.empty()) gravador.reset(new GravadorCheckpoint(arquivo_checkpoint));
+	std::chrono::steady_clock::time_point ultimo_checkpoint = std::chrono::steady_clock::now();
+	EstadoBusca estado;
+	estado.r = qtd_dezenas_jogo;
+	estado.t = qtd_dezenas_sorteio;
+	estado.m = qtd_dez_garante_acertos;
+	estado.sobreposicao = permitirSobreposicao;
+
+	preparaGarantias(todas_garantias);
+  	menorAposta=roda.empty() ? comb(qtd_dezenas_jogo, qtd_dezenas_sorteio) : roda.size();
+	if (!wheel_ticket_idxs.empty()) menorAposta = wheel_ticket_idxs.size();
+	// Sementes gastas ate a ultima tentativa inteira: a retomada refaz a cortada
+	uint64_t sementes_feitas = qtdSementesUsadas();
+  for (size_t i=feitas;i< tentativas && !PrazoBusca::acabou();i++){
+
+	INSTR_FASE(fase_tentativa, "guloso_tentativa_" + std::to_string(i + 1));
+	generateWheel(todas_garantias, wheel_ticket_idxsCopy);
+	INSTR_FASE_ENCERRA(fase_tentativa);
+
+	// Tentativa cortada pelo prazo ou por sinal volta vazia
+	if ( !wheel_ticket_idxsCopy.empty() && menorAposta > wheel_ticket_idxsCopy.size() ){
 		menorAposta = wheel_ticket_idxsCopy.size();
 		wheel_ticket_idxs = wheel_ticket_idxsCopy;
+		PrazoBusca::permiteCorte(true);
 
 		//system("pause");
 	}
+	if (!wheel_ticket_idxsCopy.empty()) {
+		feitas = i + 1;
+		sementes_feitas = qtdSementesUsadas();
+	}
 
-	cout << "total apostas "<< wheel_ticket_idxs.size() << endl;
-	cout << "Tentava "<< i+1 <<" de "<<qtdBusca<< endl;
+	cout << "total apostas "<< (wheel_ticket_idxs.empty() ? roda.size() : wheel_ticket_idxs.size()) << endl;
+	cout << "Tentava "<< i+1;
+	if (tentativas != SIZE_MAX) cout <<" de "<<tentativas;
+	cout << endl;
 	wheel_ticket_idxsCopy.clear();
 
+	if (gravador && std::chrono::steady_clock::now() - ultimo_checkpoint >=
+	                std::chrono::duration<double>(recursos.periodo_checkpoint)) {
+		estado.semente = sementeDefinida();
+		estado.sementes_usadas = sementes_feitas;
+		estado.tentativas_feitas = feitas;
+		estado.roda = wheel_ticket_idxs;
+		gravador->oferece(estado);
+		ultimo_checkpoint = std::chrono::steady_clock::now();
+	}
   }
-	//permitirSobreposicao=0;
-	std::vector<std::vector<int>> apostasTotais;
-	std::vector<std::vector<int>> combinacoes;
-  cout.flush();
+	if (gravador) {
+		estado.semente = sementeDefinida();
+		estado.sementes_usadas = sementes_feitas;
+		estado.tentativas_feitas = feitas;
+		estado.roda = wheel_ticket_idxs;
+		gravador->oferece(estado);
+	}
+	if (PrazoBusca::acabou())
+		cout << (PrazoBusca::interrompida() ? "Busca interrompida por sinal" : "Prazo da busca esgotado")
+		     << " depois de " << feitas << " tentativas; melhor roda: "
+		     << (wheel_ticket_idxs.empty() ? roda.size() : wheel_ticket_idxs.size()) << " apostas" << endl;
+	}
+
+	// O guloso as vezes deixa sorteios descobertos: a roda achada e completada
+	// e so toma o lugar da guardada se continuar menor. Ela vira dezenas de 1 a
+	// r uma vez so e, se for melhor que a da biblioteca, e guardada nela
+	if (!wheel_ticket_idxs.empty()) {
+		size_t faltavam = completaRanks(wheel_ticket_idxs, qtd_dezenas_jogo, qtd_dezenas_sorteio,
+		                                qtd_dez_garante_acertos);
+		if (faltavam)
+			cout << faltavam << " sorteios descobertos acrescentados a roda: " << wheel_ticket_idxs.size()
+			     << " apostas" << endl;
+		if (roda.empty() || wheel_ticket_idxs.size() < roda.size()) {
+			rodaDosRanks(wheel_ticket_idxs, qtd_dezenas_jogo, qtd_dezenas_sorteio, roda);
+			guardaNaBiblioteca(recursos, qtd_dezenas_jogo, qtd_dezenas_sorteio, qtd_dez_garante_acertos,
+			                   permitirSobreposicao, roda);
+		}
+	}
+}
 
-  vector<int> dez;
-  std::vector<std::vector<int>> resultados = obter_resultados("D:/programacao/LotoGanhaFacil/base/resultados.csv");
-  for (size_t k = 1; k < 26; k++)
-	dez.push_back(k);
-	geraCombinacoes(dez, qtd_dezenas_jogo, combinacoes);
+/**
+ * Jogos do trabalho: fechamentos de r dezenas do universo, sorteados sem
+ * repeticao pelo rank, cada um com a mesma roda reetiquetada, passando pelos
+ * filtros ate juntar trabalho.jogos apostas. So le os seus parametros, entao
+ * pode rodar fora da thread principal (com imprime = false).
+ **/
+static void montaJogos(const BibliotecaRodas::Roda& roda, const TrabalhoRoda& trabalho, uint64_t semente,
+                       const std::vector<std::vector<int>>& resultados, bool imprime,
+                       std::vector<std::vector<int>>& apostasTotais)
+{
+	SorteioCombinacoes fechamentos(trabalho.universo, trabalho.r, semente);
+	vector<int> fechamento;
 
-	for (size_t i = 0; i < qtd_jogos; i++)
+	for (size_t i = 0; i < trabalho.jogos && fechamentos.sorteia(fechamento); i++)
 	{
+		size_t antes = apostasTotais.size();
+		reetiquetaRoda(roda, fechamento, apostasTotais);
+		if (apostasTotais.size() > trabalho.jogos) apostasTotais.resize(trabalho.jogos);
+		if (imprime) {
+			for (size_t k = antes; k < apostasTotais.size(); ++k) {
+				for (const auto& ent:apostasTotais[k]) cout<< ent<<";";
+				cout<<'\n';
+			}
+			cout.flush();
+		}
+		aplicaFiltros(trabalho.filtros, resultados, apostasTotais);
+		if (apostasTotais.size()==trabalho.jogos)break;
+	}
+}
 
-		unsigned long seed1 = std::chrono::system_clock::now().time_since_epoch().count();
-    	 std::mt19937_64 eng(seed1);
-    	 std::uniform_int_distribution<unsigned int> distr(0, combinacoes.size()-1);
-	   	int idx = distr(eng);
+// Parte de um trabalho do lote que roda em outra thread: jogos e gravacao
+static void acabaTrabalho(TrabalhoRoda trabalho, BibliotecaRodas::Roda roda, uint64_t semente,
+                          const std::vector<std::vector<int>>* resultados, std::mutex* trava_saida,
+                          std::atomic<size_t>* falhas)
+{
+	std::vector<std::vector<int>> apostas;
+	montaJogos(roda, trabalho, semente, *resultados, false, apostas);
+	string arquivo = trabalho.saida;
+	if (arquivo.empty())
+		arquivo = "jogos_" + std::to_string(trabalho.r) + "_" + std::to_string(trabalho.t) + "_" +
+		          std::to_string(trabalho.m) + "_" + std::to_string(apostas.size()) + "_" + getCurrentDateTime() +
+		          "_linha" + std::to_string(trabalho.linha) + ".txt";
+	bool gravou = gravaApostasArquivo(apostas, arquivo);
+	if (!gravou) ++*falhas;
+
+	std::lock_guard<std::mutex> guarda(*trava_saida);
+	cout << "Linha " << trabalho.linha << " (" << trabalho.r << "/" << trabalho.t << "/" << trabalho.m << "): "
+	     << apostas.size() << " jogos de uma roda de " << roda.size() << " apostas"
+	     << (gravou ? " gravados em " + arquivo : string(", nao gravados")) << endl;
+}
 
-		generateAllCombos(dezenas_jogo,0,qtd_dezenas_sorteio, all_tickets);
-		cout << "done. (generated " << all_tickets.size() << " tickets)" << endl;
+/**
+ * Le, confere e ordena a lista de trabalhos (modo lote e coordenador). Tudo
+ * e conferido antes de comecar, para um erro de digitacao nao aparecer so no
+ * meio da noite.
+ **/
+static bool carregaLote(const string& arquivo, const TrabalhoRoda& padrao, vector<TrabalhoRoda>& trabalhos)
+{
+	string erro;
+	if (!carregaTrabalhos(arquivo, padrao, trabalhos, erro)) {
+		cerr << erro << endl;
+		return false;
+	}
+	for (size_t i = 0; i < trabalhos.size(); ++i) {
+		const TrabalhoRoda& trabalho = trabalhos[i];
+		if (!parametrosValidos(trabalho.r, trabalho.t, trabalho.m, trabalho.universo)) {
+			cerr << arquivo << ":" << trabalho.linha << ": trabalho invalido" << endl;
+			return false;
+		}
+		if (!filtrosValidos(trabalho.filtros)) {
+			cerr << arquivo << ":" << trabalho.linha << ": filtros invalidos: " << trabalho.filtros << endl;
+			return false;
+		}
+	}
+	ordenaTrabalhos(trabalhos);
+	return true;
+}
 
-		for (vector<uint64_t>::const_iterator t_idx = wheel_ticket_idxs.begin();
-		t_idx != wheel_ticket_idxs.end(); ++t_idx)
+/**
+ * Modo lote (--trabalhos ARQ, formato em TrabalhosLote.h). Os parametros do
+ * problema sao globais, entao as buscas rodam uma de cada vez (cada uma ja
+ * usa as --threads no updatePotentials). Os trabalhos vao agrupados por
+ * (r, t, m): o grafo, a biblioteca e a tabela de binomiais servem o grupo
+ * todo e o universo de tickets serve os grupos seguidos de mesmo (r, t). Os
+ * jogos de cada trabalho (reetiquetamento, filtros e gravacao) saem em outra
+ * thread enquanto o trabalho seguinte busca a sua roda.
+ **/
+static int executaLote(const string& arquivo, const TrabalhoRoda& padrao, RecursosTrabalho& recursos)
+{
+	vector<TrabalhoRoda> trabalhos;
+	if (!carregaLote(arquivo, padrao, trabalhos)) return -1;
+
+	std::mutex trava_saida;
+	std::atomic<size_t> falhas(0);
+	std::deque<std::thread> acabamentos;
+	size_t max_acabamentos = std::max<size_t>(qtdThreads / 2, 1);
+	size_t iniciados = 0;
+
+	for (size_t i = 0; i < trabalhos.size(); ++i) {
+		const TrabalhoRoda& trabalho = trabalhos[i];
+		iniciados = i + 1;
+		size_t proximo_grupo = i + 1;
+		while (proximo_grupo < trabalhos.size() && trabalhos[proximo_grupo].mesmaRoda(trabalho)) ++proximo_grupo;
+
+		if (i > 0 && !trabalho.mesmaRoda(trabalhos[i - 1])) limpaCopiasNos();
 		{
-			//cout << "\t" << ticketToString(all_tickets[*t_idx]) << endl;
-			vector<int> entrada= convertBitsetFechamento(all_tickets[*t_idx],combinacoes[idx]);
-			apostasTotais.push_back(entrada);
-			for (const auto& ent:entrada) cout<< ent<<";";
-				cout<<endl;
-			if (apostasTotais.size()==qtd_jogos)break;
-
-		}
-		int numGap = 5;
-		remove15E14Num(resultados,apostasTotais);
-   		eliminaMaiorGap(numGap, apostasTotais);
-		eliminaNumPosicao(apostasTotais);
-		eliminaNumSequencia(8,apostasTotais);
-		if (apostasTotais.size()==qtd_jogos)break;
-		wheel_ticket_idxs = wheel_ticket_idxsCopy;
-		wheel_ticket_idxsCopy.clear();
-		generateWheel(all_tickets, todas_garantias, wheel_ticket_idxsCopy);
-		combinacoes.erase(combinacoes.begin() + idx);
+			std::lock_guard<std::mutex> guarda(trava_saida);
+			cout << "\n=== Trabalho " << i + 1 << " de " << trabalhos.size() << " (linha " << trabalho.linha << "): "
+			     << trabalho.r << "/" << trabalho.t << "/" << trabalho.m << " ===" << endl;
+		}
+		defineTrabalho(trabalho);
+		manterGrafo = proximo_grupo > i + 1;
+		bool mesmo_universo = proximo_grupo < trabalhos.size() && trabalhos[proximo_grupo].r == trabalho.r &&
+		                      trabalhos[proximo_grupo].t == trabalho.t;
+		if (mesmo_universo) recursos.universo = UniversoTickets::obtem(trabalho.r, trabalho.t);
+
+		BibliotecaRodas::Roda roda;
+		if (previsaoCabe(recursos)) buscaRoda(recursos, roda);
+		if (!mesmo_universo) recursos.universo.reset();
+		if (roda.empty()) {
+			++falhas;
+			if (PrazoBusca::interrompida()) break;
+			continue;
+		}
+
+		while (acabamentos.size() >= max_acabamentos) {
+			acabamentos.front().join();
+			acabamentos.pop_front();
+		}
+		acabamentos.push_back(std::thread(acabaTrabalho, trabalho, roda, novaSemente(), &recursos.resultados,
+		                                  &trava_saida, &falhas));
+		// Com um sinal o trabalho da vez fica com a melhor roda e o lote para
+		if (PrazoBusca::interrompida()) break;
+	}
+	while (!acabamentos.empty()) {
+		acabamentos.front().join();
+		acabamentos.pop_front();
+	}
+	manterGrafo = false;
+	limpaCopiasNos();
+
+	cout << "\n" << (iniciados < trabalhos.size() ? "Lote interrompido" : "Lote concluido") << ": "
+	     << iniciados - falhas << " de " << trabalhos.size() << " trabalhos" << endl;
+	memImprimeResumo(cout);
+	return falhas || iniciados < trabalhos.size() ? -1 : 0;
+}
+
+/**
+ * Modo servidor (--servidor): atende pedidos, um por linha, da entrada
+ * padrao e responde na saida padrao, mantendo de um pedido para o outro a
+ * biblioteca, os sorteios anteriores, o grafo da ultima (r, t, m) e o
+ * universo de tickets da ultima (r, t). O resto do que o programa escreve
+ * (progresso do guloso, previsao de memoria) vai para a saida de erro.
+ *
+ * Pedido:   <id> <comando> <argumentos>
+ *   gera     r t m buscas sobreposicao jogos [opcoes de TrabalhosLote.h]
+ *   filtra   <filtros> <jogo> <jogo> ...     (dezenas do jogo separadas por ';', de 1 ao
+ *                                            universo, sem repetir; 15 com o filtro posicao)
+ *   verifica r t m [sobreposicao]            (confere a roda da biblioteca; ate
+ *                                            MAX_SORTEIOS_VERIFICA sorteios C(r, t))
+ *   estado
+ *   fim                                      (com ou sem id; encerra depois dos pendentes)
+ * Resposta: <id> ok <ms> <qtd_linhas> [resumo], seguida das linhas
+ *           <id> erro <ms> <mensagem>
+ *
+ * Os pedidos rodam em --threads threads: as buscas mexem nos parametros
+ * globais e vao uma de cada vez, o resto (jogos, filtros, conferencias) roda
+ * ao mesmo tempo. <ms> e a latencia do pedido, da leitura ate a resposta.
+ **/
+struct Servidor
+{
+	typedef std::chrono::steady_clock Relogio;
+
+	RecursosTrabalho& recursos;
+	TrabalhoRoda padrao;                   ///< o que os pedidos gera nao dizem
+	std::ostream& respostas;
+	std::mutex trava_respostas;
+	std::mutex trava_busca;                ///< parametros globais e grafo guardado
+	std::mutex trava_fila;
+	std::condition_variable cv_fila;
+	std::deque<std::pair<string, Relogio::time_point> > fila;
+	bool encerrando;
+	TrabalhoRoda grafo_de;                 ///< (r, t, m) do grafo guardado
+	std::atomic<uint64_t> atendidos;
+
+	Servidor(RecursosTrabalho& recursos, const TrabalhoRoda& padrao, std::ostream& respostas)
+		: recursos(recursos), padrao(padrao), respostas(respostas), encerrando(false), atendidos(0) {}
+
+	void responde(const string& id, Relogio::time_point inicio, bool ok, const string& resumo,
+	              const std::vector<std::vector<int>>& linhas = std::vector<std::vector<int>>()) {
+		double ms = std::chrono::duration<double, std::milli>(Relogio::now() - inicio).count();
+		std::ostringstream texto;
+		texto << id << (ok ? " ok " : " erro ") << std::fixed << std::setprecision(3) << ms;
+		if (ok) texto << " " << linhas.size();
+		if (!resumo.empty()) texto << " " << resumo;
+		texto << "\n";
+		for (size_t i = 0; i < linhas.size(); ++i) {
+			for (size_t k = 0; k < linhas[i].size(); ++k) texto << (k ? ";" : "") << linhas[i][k];
+			texto << "\n";
+		}
+		std::lock_guard<std::mutex> guarda(trava_respostas);
+		respostas << texto.str();
+		respostas.flush();
+		++atendidos;
+	}
+};
+
+static void servidorGera(Servidor& servidor, const string& id, const string& argumentos,
+                         Servidor::Relogio::time_point inicio)
+{
+	RecursosTrabalho& recursos = servidor.recursos;
+	TrabalhoRoda trabalho(servidor.padrao);
+	string erro;
+	if (!interpretaTrabalho(argumentos, trabalho, erro))
+		return servidor.responde(id, inicio, false, erro);
+	if (!filtrosValidos(trabalho.filtros))
+		return servidor.responde(id, inicio, false, "filtros invalidos: " + trabalho.filtros);
+
+	BibliotecaRodas::Roda roda;
+	uint64_t semente;
+	{
+		std::lock_guard<std::mutex> guarda(servidor.trava_busca);
+		if (!parametrosValidos(trabalho.r, trabalho.t, trabalho.m, trabalho.universo))
+			return servidor.responde(id, inicio, false, "parametros invalidos");
+		if (!servidor.grafo_de.mesmaRoda(trabalho)) limpaCopiasNos();
+		defineTrabalho(trabalho);
+		if (dirGrafoDisco.empty() && !motorSemGrafo())
+			recursos.universo = UniversoTickets::obtem(trabalho.r, trabalho.t);
+		else
+			recursos.universo.reset();
+		if (previsaoCabe(recursos)) buscaRoda(recursos, roda);
+		servidor.grafo_de = trabalho;
+		semente = novaSemente();
+	}
+	if (roda.empty())
+		return servidor.responde(id, inicio, false, "sem roda (orcamento de memoria?)");
+
+	std::vector<std::vector<int>> apostas;
+	montaJogos(roda, trabalho, semente, recursos.resultados, false, apostas);
+	if (!trabalho.saida.empty() && !gravaApostasArquivo(apostas, trabalho.saida))
+		return servidor.responde(id, inicio, false, "nao foi possivel gravar " + trabalho.saida);
+	servidor.responde(id, inicio, true, "roda=" + std::to_string(roda.size()), apostas);
+}
+
+static void servidorFiltra(Servidor& servidor, const string& id, const string& argumentos,
+                           Servidor::Relogio::time_point inicio)
+{
+	std::istringstream campos(argumentos);
+	string filtros, jogo;
+	std::vector<std::pair<string, int> > passos;
+	if (!(campos >> filtros) || !interpretaFiltros(filtros, passos))
+		return servidor.responde(id, inicio, false, "filtros invalidos: " + filtros);
+	bool com_posicao = false;
+	for (size_t i = 0; i < passos.size(); ++i) com_posicao = com_posicao || passos[i].first == "posicao";
+
+	// Os filtros indexam direto pelas dezenas (e o posicao pelas 15 casas da
+	// Lotofacil): o jogo fora disso e recusado antes de chegar neles
+	std::vector<std::vector<int>> jogos;
+	while (campos >> jogo) {
+		std::istringstream dezenas(jogo);
+		string dezena, numero = std::to_string(jogos.size() + 1);
+		jogos.push_back(vector<int>());
+		while (std::getline(dezenas, dezena, ';')) {
+			char* fim = NULL;
+			long valor = strtol(dezena.c_str(), &fim, 10);
+			if (dezena.empty() || *fim != '\0' || valor < 1 || valor > static_cast<long>(servidor.padrao.universo))
+				return servidor.responde(id, inicio, false, "dezena invalida no jogo " + numero + ": " + dezena);
+			jogos.back().push_back(static_cast<int>(valor));
+		}
+		vector<int> ordenado = jogos.back();
+		std::sort(ordenado.begin(), ordenado.end());
+		if (std::adjacent_find(ordenado.begin(), ordenado.end()) != ordenado.end())
+			return servidor.responde(id, inicio, false, "dezena repetida no jogo " + numero);
+		if (com_posicao && ordenado.size() != 15)
+			return servidor.responde(id, inicio, false, "o filtro posicao precisa de 15 dezenas, jogo " + numero);
+	}
+	aplicaFiltros(filtros, servidor.recursos.resultados, jogos);
+	servidor.responde(id, inicio, true, "", jogos);
+}
+
+// Sorteios que um 'verifica' confere (uma consulta ao indice de cada um),
+// para que um pedido nao prenda uma thread do servidor por horas
+const uint64_t MAX_SORTEIOS_VERIFICA = UINT64_C(1) << 26;
+
+static void servidorVerifica(Servidor& servidor, const string& id, const string& argumentos,
+                             Servidor::Relogio::time_point inicio)
+{
+	std::istringstream campos(argumentos);
+	size_t r, t, m, sobreposicao = servidor.padrao.sobreposicao;
+	if (!(campos >> r >> t >> m) || t > r || m > t)
+		return servidor.responde(id, inicio, false, "esperava r t m [sobreposicao]");
+	if (binomial(r, t) > MAX_SORTEIOS_VERIFICA)
+		return servidor.responde(id, inicio, false, "sorteios demais para conferir: C(" + std::to_string(r) + ", " +
+		                         std::to_string(t) + ") acima de " + std::to_string(MAX_SORTEIOS_VERIFICA));
+	campos >> sobreposicao;
+	BibliotecaRodas::Roda roda;
+	{
+		std::lock_guard<std::mutex> guarda(servidor.recursos.trava_biblioteca);
+		const BibliotecaRodas::Roda* guardada = servidor.recursos.biblioteca.busca(r, t, m, sobreposicao);
+		if (guardada) roda = *guardada;
+	}
+	if (roda.empty())
+		return servidor.responde(id, inicio, false, "roda fora da biblioteca");
+	uint64_t descobertos = confereRoda(roda, r, t, m);
+	if (descobertos == UINT64_MAX)
+		return servidor.responde(id, inicio, false, "dezenas demais para conferir");
+	servidor.responde(id, inicio, true, (descobertos == 0 ? "garante" : "falha") + string(" apostas=") +
+	                  std::to_string(roda.size()) + " descobertos=" + std::to_string(descobertos));
+}
+
+static void servidorAtende(Servidor& servidor, const string& linha, Servidor::Relogio::time_point inicio)
+{
+	std::istringstream campos(linha);
+	string id, comando, argumentos;
+	campos >> id >> comando;
+	std::getline(campos, argumentos);
+	if (comando == "gera") servidorGera(servidor, id, argumentos, inicio);
+	else if (comando == "filtra") servidorFiltra(servidor, id, argumentos, inicio);
+	else if (comando == "verifica") servidorVerifica(servidor, id, argumentos, inicio);
+	else if (comando == "estado") {
+		std::ostringstream resumo;
+		{
+			std::lock_guard<std::mutex> guarda(servidor.trava_busca);
+			resumo << "atendidos=" << servidor.atendidos << " grafo=" << servidor.grafo_de.r << "/"
+			       << servidor.grafo_de.t << "/" << servidor.grafo_de.m << (grafoGuardado() ? "" : "(vazio)");
+		}
+		resumo << " resultados=" << servidor.recursos.resultados.size();
+		servidor.responde(id, inicio, true, resumo.str());
+	}
+	else servidor.responde(id, inicio, false, "comando desconhecido: " + comando);
+}
+
+static void servidorTrabalha(Servidor* servidor)
+{
+	while (true) {
+		std::pair<string, Servidor::Relogio::time_point> pedido;
+		{
+			std::unique_lock<std::mutex> trava(servidor->trava_fila);
+			servidor->cv_fila.wait(trava, [&]() { return servidor->encerrando || !servidor->fila.empty(); });
+			if (servidor->fila.empty()) return;
+			pedido = servidor->fila.front();
+			servidor->fila.pop_front();
+		}
+		servidorAtende(*servidor, pedido.first, pedido.second);
+	}
+}
+
+static int executaServidor(RecursosTrabalho& recursos, const TrabalhoRoda& padrao)
+{
+	// As respostas ficam com a saida padrao; o resto passa para a de erro
+	std::ostream respostas(cout.rdbuf());
+	std::streambuf* saida_original = cout.rdbuf(cerr.rdbuf());
+	manterGrafo = true;
+
+	Servidor servidor(recursos, padrao, respostas);
+	vector<std::thread> threads;
+	for (size_t i = 0; i < std::max<size_t>(qtdThreads, 1); ++i)
+		threads.push_back(std::thread(servidorTrabalha, &servidor));
+
+	string linha;
+	while (std::getline(cin, linha)) {
+		Servidor::Relogio::time_point inicio = Servidor::Relogio::now();
+		std::istringstream campos(linha);
+		string id, comando;
+		if (!(campos >> id)) continue;
+		campos >> comando;
+		if (comando == "fim" || (id == "fim" && comando.empty())) break;
+		std::lock_guard<std::mutex> trava(servidor.trava_fila);
+		servidor.fila.push_back(std::make_pair(linha, inicio));
+		servidor.cv_fila.notify_one();
+	}
+	{
+		std::lock_guard<std::mutex> trava(servidor.trava_fila);
+		servidor.encerrando = true;
+	}
+	servidor.cv_fila.notify_all();
+	for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+	manterGrafo = false;
+	limpaCopiasNos();
+	recursos.universo.reset();
+	memImprimeResumo(cout);
+	cout.rdbuf(saida_original);
+	return 0;
+}
+
+/**
+ * Modo coordenador (--coordenador PORTA; protocolo em CoordenadorBusca.h).
+ * O coordenador nao busca: os trabalhos vao um de cada vez, na ordem do
+ * lote, e as tentativas de cada um saem em blocos de --bloco tentativas para
+ * quem estiver conectado. A menor roda recebida vai para todos; no fim do
+ * trabalho ela vai para a biblioteca e os jogos saem como no modo lote. Um
+ * trabalhador que cai devolve o bloco, que sai de novo para outro.
+ **/
+struct Coordenador
+{
+	RecursosTrabalho& recursos;
+	size_t tamanho_bloco;
+	std::mutex trava;
+	std::condition_variable cv;
+	vector<CanalTcp*> canais;          ///< conexoes abertas, para 'menor', 'para' e o encerramento
+	vector<std::thread> conexoes;
+	bool encerrando;
+	// Trabalho da vez
+	bool tem_trabalho, parando;
+	TrabalhoRoda trabalho;
+	uint64_t semente;
+	size_t qtd_blocos, proximo_bloco;  ///< qtd_blocos SIZE_MAX = enquanto houver prazo
+	size_t pendentes;                  ///< blocos entregues e ainda sem 'feito'
+	std::deque<BlocoBusca> devolvidos;
+	uint64_t proximo_id;
+	size_t menor;                      ///< menor roda do trabalho, da biblioteca ou recebida
+	vector<uint64_t> melhor;           ///< ranks da menor roda recebida; vazia = nenhuma
+	size_t tentativas_feitas;
+	std::set<const CanalTcp*> vazios;  ///< conexoes que deram 'feito' com 0 tentativas (grafo nao coube...)
+
+	Coordenador(RecursosTrabalho& recursos, size_t tamanho_bloco)
+		: recursos(recursos), tamanho_bloco(tamanho_bloco), encerrando(false), tem_trabalho(false), parando(false),
+		  semente(0), qtd_blocos(0), proximo_bloco(0), pendentes(0), proximo_id(1), menor(0), tentativas_feitas(0) {}
+
+	// O resto e chamado com a trava
+	bool temBloco() const {
+		return tem_trabalho && !parando && (!devolvidos.empty() || proximo_bloco < qtd_blocos);
+	}
+
+	bool trabalhoAcabou() const {
+		return pendentes == 0 && (parando || (devolvidos.empty() && proximo_bloco >= qtd_blocos));
+	}
+
+	// Todos os conectados devolveram blocos sem rodar nenhuma tentativa
+	bool semTentativas() const {
+		if (tentativas_feitas > 0 || canais.empty()) return false;
+		for (size_t i = 0; i < canais.size(); ++i)
+			if (!vazios.count(canais[i])) return false;
+		return true;
+	}
+
+	BlocoBusca tiraBloco() {
+		BlocoBusca bloco;
+		if (!devolvidos.empty()) {
+			bloco = devolvidos.front();
+			devolvidos.pop_front();
+		} else {
+			bloco.id = proximo_id++;
+			bloco.r = trabalho.r;
+			bloco.t = trabalho.t;
+			bloco.m = trabalho.m;
+			bloco.sobreposicao = trabalho.sobreposicao;
+			bloco.semente = semente;
+			bloco.primeira_semente = proximo_bloco * SEMENTES_POR_BLOCO;
+			bloco.tentativas = tamanho_bloco;
+			if (qtd_blocos != SIZE_MAX)
+				bloco.tentativas = std::min(tamanho_bloco, trabalho.buscas - proximo_bloco * tamanho_bloco);
+			++proximo_bloco;
+		}
+		bloco.menor = menor;
+		++pendentes;
+		return bloco;
+	}
+
+	void difunde(const string& linha) {
+		for (size_t i = 0; i < canais.size(); ++i) canais[i]->envia(linha);
+	}
+
+	// Com a roda ja conferida (rodaGarante); so fica se ainda for a menor
+	void recebeRoda(const BlocoBusca& bloco, const vector<uint64_t>& ranks) {
+		if (ranks.empty() || ranks.size() >= menor) return;
+		menor = ranks.size();
+		melhor = ranks;
+		PrazoBusca::permiteCorte(true);
+		cout << "Roda de " << menor << " apostas (bloco " << bloco.id << ")" << endl;
+		difunde("menor " + std::to_string(bloco.r) + " " + std::to_string(bloco.t) + " " +
+		        std::to_string(bloco.m) + " " + std::to_string(menor) + "\n");
+	}
+};
+
+/**
+ * Confere por inteiro uma roda recebida, sem a trava do coordenador (a
+ * conferencia e por forca bruta). Os trabalhadores nao se identificam e o
+ * guloso as vezes deixa sorteios descobertos: so a roda que garante m vira a
+ * 'menor' do trabalho, que corta as tentativas de todos.
+ **/
+static bool rodaGarante(const BlocoBusca& bloco, const vector<uint64_t>& ranks)
+{
+	uint64_t qtd_tickets = comb(bloco.r, bloco.t);
+	for (size_t k = 0; k < ranks.size(); ++k)
+		if (ranks[k] >= qtd_tickets) return false;
+	BibliotecaRodas::Roda roda;
+	rodaDosRanks(ranks, bloco.r, bloco.t, roda);
+	uint64_t descobertos = confereRoda(roda, bloco.r, bloco.t, bloco.m);
+	if (descobertos == 0) return true;
+	cerr << "Roda de " << ranks.size() << " apostas do bloco " << bloco.id << " descartada: "
+	     << (descobertos == UINT64_MAX ? string("dezenas demais para conferir")
+	                                   : std::to_string(descobertos) + " sorteios descobertos") << endl;
+	return false;
+}
+
+// Uma conexao: entrega um bloco de cada vez e recebe as rodas e o 'feito'
+static void coordenadorAtende(Coordenador* coordenador, unique_ptr<CanalTcp> canal)
+{
+	{
+		std::lock_guard<std::mutex> trava(coordenador->trava);
+		if (coordenador->encerrando) return;
+		coordenador->canais.push_back(canal.get());
+	}
+	string linha;
+	bool vivo = canal->recebeLinha(linha) && linha == "trabalhador";
+	if (vivo) {
+		std::lock_guard<std::mutex> trava(coordenador->trava);
+		cout << "Trabalhador conectado (" << coordenador->canais.size() << " conectados)" << endl;
+	}
+	while (vivo) {
+		BlocoBusca bloco;
+		{
+			std::unique_lock<std::mutex> trava(coordenador->trava);
+			coordenador->cv.wait(trava, [&]() { return coordenador->encerrando || coordenador->temBloco(); });
+			if (coordenador->encerrando) break;
+			bloco = coordenador->tiraBloco();
+			// Ainda com a trava: nenhum 'menor' passa na frente do bloco
+			vivo = canal->envia(bloco.linha());
+		}
+		bool feito = false;
+		size_t tentativas = 0;
+		while (vivo && !feito && (vivo = canal->recebeLinha(linha))) {
+			std::istringstream campos(linha);
+			string marca;
+			uint64_t id = 0;
+			campos >> marca;
+			if (marca == "roda") {
+				vector<uint64_t> ranks;
+				if (interpretaRoda(campos, id, ranks, bloco.menor) && id == bloco.id && !ranks.empty()) {
+					bool menor;
+					{
+						std::lock_guard<std::mutex> trava(coordenador->trava);
+						menor = ranks.size() < coordenador->menor;
+					}
+					if (menor && rodaGarante(bloco, ranks)) {
+						std::lock_guard<std::mutex> trava(coordenador->trava);
+						coordenador->recebeRoda(bloco, ranks);
+					}
+				}
+			} else if (marca == "feito")
+				feito = (campos >> id >> tentativas) && id == bloco.id;
+		}
+		std::lock_guard<std::mutex> trava(coordenador->trava);
+		--coordenador->pendentes;
+		if (feito) {
+			coordenador->tentativas_feitas += tentativas;
+			if (tentativas == 0) coordenador->vazios.insert(canal.get());
+		} else
+			coordenador->devolvidos.push_back(bloco);
+		coordenador->cv.notify_all();
+	}
+	canal->envia("fim\n");
+	std::lock_guard<std::mutex> trava(coordenador->trava);
+	coordenador->canais.erase(std::find(coordenador->canais.begin(), coordenador->canais.end(), canal.get()));
+	coordenador->vazios.erase(canal.get());
+	if (!vivo) cout << "Trabalhador desconectado (" << coordenador->canais.size() << " conectados)" << endl;
+	coordenador->cv.notify_all();
+}
+
+static void coordenadorAceita(Coordenador* coordenador, CanalTcp* escuta)
+{
+	while (true) {
+		unique_ptr<CanalTcp> canal = escuta->aceita();
+		if (!canal) return;
+		std::lock_guard<std::mutex> trava(coordenador->trava);
+		if (coordenador->encerrando) return;
+		coordenador->conexoes.push_back(std::thread(coordenadorAtende, coordenador, std::move(canal)));
 	}
+}
+
+/**
+ * Roda um trabalhador local ate ele acabar, repassando a saida dele com o
+ * numero na frente. popen e nao system(), que ignora o SIGINT do processo
+ * inteiro enquanto espera.
+ **/
+static void lancaTrabalhadorLocal(string comando, size_t numero, std::atomic<size_t>* vivos)
+{
+#ifdef _WIN32
+	FILE* saida = _popen(comando.c_str(), "r");
+#else
+	FILE* saida = popen(comando.c_str(), "r");
+#endif
+	int resultado = -1;
+	if (saida) {
+		char linha[4096];
+		string prefixo = "[" + std::to_string(numero) + "] ";
+		while (fgets(linha, sizeof(linha), saida)) cout << prefixo + linha << std::flush;
+#ifdef _WIN32
+		resultado = _pclose(saida);
+#else
+		resultado = pclose(saida);
+#endif
+	}
+	if (resultado != 0) cerr << "Trabalhador local " << numero << " terminou com erro: " << comando << endl;
+	--*vivos;
+}
+
+static int executaCoordenador(unsigned porta, vector<TrabalhoRoda>& trabalhos, size_t tamanho_bloco,
+                              size_t qtd_locais, const string& comando_local, RecursosTrabalho& recursos)
+{
+	// Com a porta 0 so os trabalhadores locais sabem onde ela esta
+	CanalTcp escuta;
+	if (!escuta.escuta(porta, porta == 0)) {
+		cerr << "Nao foi possivel escutar na porta " << porta << endl;
+		return -1;
+	}
+	cout << "Coordenador na porta " << porta << ": " << trabalhos.size() << " trabalhos em blocos de "
+	     << tamanho_bloco << " tentativas" << endl;
+
+	Coordenador coordenador(recursos, tamanho_bloco);
+	std::thread aceitador(coordenadorAceita, &coordenador, &escuta);
+	std::atomic<size_t> locais_vivos(qtd_locais);
+	vector<std::thread> locais;
+	for (size_t i = 0; i < qtd_locais; ++i)
+		locais.push_back(std::thread(lancaTrabalhadorLocal, comando_local + " --trabalhador 127.0.0.1:" +
+		                             std::to_string(porta), i + 1, &locais_vivos));
+
+	std::mutex trava_saida;
+	std::atomic<size_t> falhas(0);
+	std::deque<std::thread> acabamentos;
+	size_t max_acabamentos = std::max<size_t>(qtdThreads / 2, 1);
+	size_t iniciados = 0;
+
+	for (size_t i = 0; i < trabalhos.size() && !PrazoBusca::interrompida(); ++i) {
+		const TrabalhoRoda& trabalho = trabalhos[i];
+		iniciados = i + 1;
+		BibliotecaRodas::Roda roda;
+		{
+			std::lock_guard<std::mutex> guarda(recursos.trava_biblioteca);
+			const BibliotecaRodas::Roda* guardada = recursos.biblioteca.busca(trabalho.r, trabalho.t, trabalho.m,
+			                                                                  trabalho.sobreposicao);
+			if (guardada) roda = *guardada;
+		}
+		size_t tentativas;
+		bool sem_trabalhadores = false, sem_tentativas = false;
+		vector<uint64_t> melhor;
+		{
+			std::unique_lock<std::mutex> trava(coordenador.trava);
+			cout << "\n=== Trabalho " << i + 1 << " de " << trabalhos.size() << " (linha " << trabalho.linha << "): "
+			     << trabalho.r << "/" << trabalho.t << "/" << trabalho.m << ", " << coordenador.canais.size()
+			     << " trabalhadores ===" << endl;
+			coordenador.trabalho = trabalho;
+			coordenador.semente = trabalho.semente ? trabalho.semente
+			                      : std::chrono::system_clock::now().time_since_epoch().count() | 1;
+			coordenador.menor = roda.empty() ? comb(trabalho.r, trabalho.t) : roda.size();
+			coordenador.melhor.clear();
+			coordenador.devolvidos.clear();
+			coordenador.proximo_bloco = 0;
+			coordenador.tentativas_feitas = 0;
+			coordenador.vazios.clear();
+			coordenador.parando = false;
+			// Mesma conta da busca avulsa: sem roda guardada, pelo menos uma tentativa
+			tentativas = roda.empty() ? std::max<size_t>(trabalho.buscas, 1) : trabalho.buscas;
+			coordenador.qtd_blocos = trabalho.tempo > 0 && trabalho.buscas == 0 ? SIZE_MAX
+			                         : (tentativas + tamanho_bloco - 1) / tamanho_bloco;
+			coordenador.trabalho.buscas = tentativas;
+			PrazoBusca::inicia(trabalho.tempo);
+			PrazoBusca::permiteCorte(!roda.empty());
+			coordenador.tem_trabalho = true;
+			coordenador.cv.notify_all();
+
+			while (!coordenador.trabalhoAcabou()) {
+				coordenador.cv.wait_for(trava, std::chrono::milliseconds(200));
+				// So com trabalhadores locais da para saber que nao vem mais ninguem
+				sem_trabalhadores = qtd_locais > 0 && locais_vivos == 0 && coordenador.canais.empty();
+				// Sem isso um trabalho por tempo sem roda guardada, em que nenhum
+				// trabalhador consegue rodar tentativas, nunca acabaria
+				sem_tentativas = coordenador.semTentativas();
+				if (!coordenador.parando && (PrazoBusca::acabou() || sem_trabalhadores || sem_tentativas)) {
+					coordenador.parando = true;
+					coordenador.difunde("para\n");
+				}
+			}
+			coordenador.tem_trabalho = false;
+			cout << "Trabalho " << trabalho.r << "/" << trabalho.t << "/" << trabalho.m << ": "
+			     << coordenador.tentativas_feitas << " tentativas, "
+			     << (coordenador.melhor.empty() && roda.empty() ? string("sem roda completa")
+			         : "roda de " + std::to_string(coordenador.melhor.empty() ? roda.size() : coordenador.melhor.size()) + " apostas")
+			     << (PrazoBusca::interrompida() ? " (interrompido por sinal)" : "") << endl;
+			melhor.swap(coordenador.melhor);
+		}
+		// Ja conferida ao chegar
+		if (!melhor.empty()) rodaDosRanks(melhor, trabalho.r, trabalho.t, roda);
+		if (sem_trabalhadores) {
+			cerr << "Os trabalhadores locais terminaram; o coordenador para aqui" << endl;
+			++falhas;
+			break;
+		}
+		if (sem_tentativas)
+			cerr << "Os blocos voltaram sem tentativas (grafo grande demais para os trabalhadores?)" << endl;
+		if (roda.empty()) {
+			++falhas;
+			continue;
+		}
+		guardaNaBiblioteca(recursos, trabalho.r, trabalho.t, trabalho.m, trabalho.sobreposicao, roda);
+
+		while (acabamentos.size() >= max_acabamentos) {
+			acabamentos.front().join();
+			acabamentos.pop_front();
+		}
+		acabamentos.push_back(std::thread(acabaTrabalho, trabalho, roda, coordenador.semente, &recursos.resultados,
+		                                  &trava_saida, &falhas));
+	}
+	while (!acabamentos.empty()) {
+		acabamentos.front().join();
+		acabamentos.pop_front();
+	}
+
+	// Os trabalhadores recebem 'fim' (ou veem o canal fechar); a conexao a si
+	// mesmo so acorda o aceitador
+	{
+		std::lock_guard<std::mutex> trava(coordenador.trava);
+		coordenador.encerrando = true;
+		coordenador.cv.notify_all();
+		for (size_t i = 0; i < coordenador.canais.size(); ++i) coordenador.canais[i]->encerra();
+	}
+	CanalTcp despertador;
+	despertador.conecta("127.0.0.1", porta);
+	aceitador.join();
+	for (size_t i = 0; i < coordenador.conexoes.size(); ++i) coordenador.conexoes[i].join();
+	for (size_t i = 0; i < locais.size(); ++i) locais[i].join();
+
+	cout << "\n" << (iniciados < trabalhos.size() || PrazoBusca::interrompida() ? "Coordenador interrompido"
+	                                                                            : "Coordenador concluido")
+	     << ": " << iniciados - falhas << " de " << trabalhos.size() << " trabalhos" << endl;
+	memImprimeResumo(cout);
+	return falhas || iniciados < trabalhos.size() ? -1 : 0;
+}
+
+/**
+ * Modo trabalhador (--trabalhador HOST:PORTA). Roda os blocos do
+ * coordenador com as opcoes do guloso da propria linha de comando e guarda o
+ * grafo enquanto os blocos forem do mesmo (r, t, m). Uma thread le o canal:
+ * a menor roda que chega vai para menorApostaCompartilhada, que corta as
+ * tentativas em andamento, e os blocos vao para a fila.
+ **/
+struct Trabalhador
+{
+	CanalTcp canal;
+	std::mutex trava;
+	std::condition_variable cv;
+	std::deque<BlocoBusca> blocos;
+	bool fim;
+
+	Trabalhador() : fim(false) {}
+};
+
+static void trabalhadorRecebe(Trabalhador* trabalhador)
+{
+	BlocoBusca atual;
+	string linha;
+	while (trabalhador->canal.recebeLinha(linha)) {
+		std::istringstream campos(linha);
+		string marca;
+		size_t r, t, m, qtd;
+		campos >> marca;
+		if (marca == "menor" && (campos >> r >> t >> m >> qtd) && atual.mesmaRoda(r, t, m)) {
+			size_t conhecida = menorApostaCompartilhada.load();
+			while (qtd < conhecida && !menorApostaCompartilhada.compare_exchange_weak(conhecida, qtd)) {}
+		} else if (marca == "para")
+			menorApostaCompartilhada = 0;
+		else if (marca == "bloco" && interpretaBloco(linha, atual)) {
+			// Na ordem do canal: um 'menor' que vier depois do bloco vale para ele
+			menorApostaCompartilhada = atual.menor;
+			std::lock_guard<std::mutex> trava(trabalhador->trava);
+			trabalhador->blocos.push_back(atual);
+			trabalhador->cv.notify_one();
+		} else if (marca == "fim")
+			break;
+	}
+	std::lock_guard<std::mutex> trava(trabalhador->trava);
+	trabalhador->fim = true;
+	trabalhador->cv.notify_one();
+}
+
+// Tentativas de um bloco; cada roda menor que a conhecida vai na hora para o coordenador
+static size_t trabalhadorBusca(CanalTcp& canal, const BlocoBusca& bloco)
+{
+	std::vector<boost::dynamic_bitset<>> todas_garantias;
+	vector<uint64_t> wheel_ticket_idxs;
+	preparaGarantias(todas_garantias);
+	menorAposta = bloco.menor;
+	size_t feitas = 0;
+	for (size_t i = 0; i < bloco.tentativas && menorApostaCompartilhada != 0 && !PrazoBusca::acabou(); ++i) {
+		INSTR_FASE(fase_tentativa, "guloso_bloco_" + std::to_string(bloco.id) + "_" + std::to_string(i + 1));
+		generateWheel(todas_garantias, wheel_ticket_idxs);
+		INSTR_FASE_ENCERRA(fase_tentativa);
+		// Cortada por 'para': nao conta nem vale
+		if (menorApostaCompartilhada == 0) break;
+		if (!wheel_ticket_idxs.empty()) ++feitas;
+		size_t conhecida = std::min(menorAposta, menorApostaCompartilhada.load());
+		// O coordenador so aceita roda completa
+		if (!wheel_ticket_idxs.empty() && wheel_ticket_idxs.size() < conhecida) {
+			size_t faltavam = completaRanks(wheel_ticket_idxs, bloco.r, bloco.t, bloco.m);
+			if (faltavam)
+				cout << "Bloco " << bloco.id << ": " << faltavam << " sorteios descobertos acrescentados a roda" << endl;
+		}
+		if (!wheel_ticket_idxs.empty() && wheel_ticket_idxs.size() < conhecida) {
+			menorAposta = wheel_ticket_idxs.size();
+			canal.envia(linhaRoda(bloco.id, wheel_ticket_idxs));
+			cout << "Bloco " << bloco.id << ": roda de " << menorAposta << " apostas enviada" << endl;
+		} else
+			menorAposta = conhecida;
+		wheel_ticket_idxs.clear();
+	}
+	return feitas;
+}
+
+static int executaTrabalhador(const string& endereco, RecursosTrabalho& recursos)
+{
+	string host;
+	unsigned porta = 0;
+	if (!separaEndereco(endereco, host, porta)) {
+		cerr << "Endereco invalido: " << endereco << " (use HOST:PORTA)" << endl;
+		return -1;
+	}
+	// O coordenador pode subir depois dos trabalhadores
+	Trabalhador trabalhador;
+	bool conectou = false;
+	for (int i = 0; i < 30 && !PrazoBusca::interrompida(); ++i) {
+		if ((conectou = trabalhador.canal.conecta(host, porta))) break;
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+	if (!conectou || !trabalhador.canal.envia("trabalhador\n")) {
+		cerr << "Sem coordenador em " << host << ":" << porta << endl;
+		return -1;
+	}
+	cout << "Trabalhador conectado a " << host << ":" << porta << endl;
+	manterGrafo = true;
+	std::thread receptor(trabalhadorRecebe, &trabalhador);
+
+	BlocoBusca grafo_de;
+	bool cabe = false;
+	size_t qtd_blocos = 0, qtd_tentativas = 0;
+	while (!PrazoBusca::interrompida()) {
+		BlocoBusca bloco;
+		{
+			std::unique_lock<std::mutex> trava(trabalhador.trava);
+			trabalhador.cv.wait(trava, [&]() { return trabalhador.fim || !trabalhador.blocos.empty(); });
+			if (trabalhador.blocos.empty()) break;
+			bloco = trabalhador.blocos.front();
+			trabalhador.blocos.pop_front();
+		}
+		TrabalhoRoda trabalho;
+		trabalho.r = bloco.r;
+		trabalho.t = bloco.t;
+		trabalho.m = bloco.m;
+		trabalho.universo = bloco.r;
+		trabalho.buscas = bloco.tentativas;
+		trabalho.sobreposicao = bloco.sobreposicao;
+		size_t feitas = 0;
+		if (!grafo_de.mesmaRoda(bloco.r, bloco.t, bloco.m)) {
+			limpaCopiasNos();
+			cabe = parametrosValidos(bloco.r, bloco.t, bloco.m, trabalho.universo);
+			if (cabe) {
+				defineTrabalho(trabalho);
+				if (dirGrafoDisco.empty() && !motorSemGrafo())
+					recursos.universo = UniversoTickets::obtem(trabalho.r, trabalho.t);
+				else
+					recursos.universo.reset();
+				cabe = previsaoCabe(recursos);
+			}
+			grafo_de = bloco;
+		}
+		if (cabe) {
+			defineTrabalho(trabalho);
+			defineSemente(bloco.semente, bloco.primeira_semente);
+			feitas = trabalhadorBusca(trabalhador.canal, bloco);
+		}
+		++qtd_blocos;
+		qtd_tentativas += feitas;
+		if (!trabalhador.canal.envia("feito " + std::to_string(bloco.id) + " " + std::to_string(feitas) + "\n")) break;
+	}
+	trabalhador.canal.encerra();
+	receptor.join();
+
+	manterGrafo = false;
+	limpaCopiasNos();
+	recursos.universo.reset();
+	cout << "Trabalhador encerrado: " << qtd_blocos << " blocos, " << qtd_tentativas << " tentativas" << endl;
+	memImprimeResumo(cout);
+	return 0;
+}
+
+/**
+ * Linha de comando dos --trabalhadores-locais: este mesmo programa com as
+ * opcoes do guloso, as --threads divididas entre eles e sem biblioteca (quem
+ * guarda a roda e o coordenador).
+ **/
+static string comandoTrabalhadorLocal(const string& programa, unordered_map<string, string>& opcoes, size_t qtd_locais)
+{
+	static const char* repassadas[] = { "limiar-paralelo", "grafo-disco", "shard-mb", "simetria", "lote", "motor",
+	                                    "guloso", "orcamento-memoria" };
+	string comando = programa.find(' ') == string::npos ? programa : "\"" + programa + "\"";
+	for (size_t i = 0; i < sizeof(repassadas) / sizeof(repassadas[0]); ++i)
+		if (opcoes.count(repassadas[i])) comando += string(" --") + repassadas[i] + "=" + opcoes[repassadas[i]];
+	size_t threads = opcoes.count("threads") ? qtdThreads : std::max<size_t>(qtdThreads / qtd_locais, 1);
+	return comando + " --threads=" + std::to_string(threads) + " --biblioteca=";
+}
+
+int main(int argc, char *argv[])
+{
+	vector<string> args;
+	unordered_map<string, string> opcoes;
+
+	separaOpcoes(argc, argv, args, opcoes);
+	if (opcoes.count("relatorio")) instrDefineRelatorio(opcoes["relatorio"]);
+	qtdThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	if (opcoes.count("threads")) qtdThreads = std::max(atoi(opcoes["threads"].c_str()), 1);
+	if (opcoes.count("limiar-paralelo")) limiarParalelo = strtoull(opcoes["limiar-paralelo"].c_str(), NULL, 10);
+	// Dezenas da loteria de onde saem as do fechamento (25 na Lotofacil)
+	size_t universo = 25;
+	if (opcoes.count("universo")) universo = strtoull(opcoes["universo"].c_str(), NULL, 10);
+	if (opcoes.count("grafo-disco")) dirGrafoDisco = opcoes["grafo-disco"];
+	if (opcoes.count("shard-mb"))
+		bytesShardGrafoDisco = std::max<uint64_t>(strtoull(opcoes["shard-mb"].c_str(), NULL, 10), 1) << 20;
+	if (opcoes.count("simetria")) profundidadeSimetria = strtoull(opcoes["simetria"].c_str(), NULL, 10);
+	if (opcoes.count("lote")) tamanhoLote = std::max<size_t>(strtoull(opcoes["lote"].c_str(), NULL, 10), 1);
+	if (opcoes.count("motor")) {
+		if (opcoes["motor"] == "fixo") motorGuloso = MOTOR_FIXO;
+		else if (opcoes["motor"] == "generico") motorGuloso = MOTOR_GENERICO;
+		else if (opcoes["motor"] == "implicito") motorGuloso = MOTOR_IMPLICITO;
+		else if (opcoes["motor"] == "troca") motorGuloso = MOTOR_TROCA;
+		else if (opcoes["motor"] != "automatico") {
+			cerr << "Motor desconhecido: " << opcoes["motor"]
+			     << " (use automatico, fixo, generico, implicito ou troca)" << endl;
+			return -1;
+		}
+	}
+	if (opcoes.count("guloso")) {
+		if (opcoes["guloso"] == "lazy") modoGuloso = GULOSO_PREGUICOSO;
+		else if (opcoes["guloso"] == "lote") modoGuloso = GULOSO_LOTE;
+		else if (opcoes["guloso"] != "padrao") {
+			cerr << "Modo de guloso desconhecido: " << opcoes["guloso"] << " (use padrao, lazy ou lote)" << endl;
+			return -1;
+		}
+	}
+
+	// Biblioteca de rodas (BibliotecaRodas.h) e sorteios anteriores, lidos uma
+	// vez para todos os trabalhos
+	RecursosTrabalho recursos(opcoes.count("biblioteca") ? opcoes["biblioteca"] : "rodas_biblioteca.txt");
+	if (opcoes.count("orcamento-memoria")) {
+		recursos.tem_orcamento = true;
+		recursos.orcamento = strtoull(opcoes["orcamento-memoria"].c_str(), NULL, 10) << 20;
+	}
+	// O trabalhador so busca: a biblioteca, os jogos e os filtros ficam com o coordenador
+	if (opcoes.count("trabalhador")) {
+		PrazoBusca::instalaSinais();
+		return executaTrabalhador(opcoes["trabalhador"], recursos);
+	}
+	if (!recursos.biblioteca.nomeArquivo().empty()) recursos.biblioteca.carrega();
+	recursos.resultados = obter_resultados("D:/programacao/LotoGanhaFacil/base/resultados.csv");
+	memInstalaAvisoFaltaMemoria();
+
+	// Tambem e o padrao do que os trabalhos do lote e os pedidos do servidor
+	// nao disserem
+	TrabalhoRoda trabalho;
+	trabalho.universo = universo;
+	if (opcoes.count("semente")) trabalho.semente = strtoull(opcoes["semente"].c_str(), NULL, 10);
+	if (opcoes.count("filtros")) trabalho.filtros = opcoes["filtros"];
+	if (opcoes.count("tempo")) trabalho.tempo = strtod(opcoes["tempo"].c_str(), NULL);
+	if (!filtrosValidos(trabalho.filtros)) {
+		cerr << "Filtros invalidos: " << trabalho.filtros
+		     << " (use padrao, nenhum ou uma lista de resultados, gap:N, posicao e sequencia:N)" << endl;
+		return -1;
+	}
+	// O servidor fica com o comportamento normal dos sinais; nos outros modos
+	// o primeiro SIGINT/SIGTERM para a busca e fica com a melhor roda
+	if (opcoes.count("servidor")) return executaServidor(recursos, trabalho);
+	PrazoBusca::instalaSinais();
+	if (opcoes.count("coordenador")) {
+		// Os trabalhos vem do --trabalhos ou dos 6 parametros de sempre
+		vector<TrabalhoRoda> trabalhos;
+		if (opcoes.count("trabalhos")) {
+			if (!carregaLote(opcoes["trabalhos"], trabalho, trabalhos)) return -1;
+		} else if (args.size() == 6) {
+			string erro, linha = args[0];
+			for (size_t i = 1; i < args.size(); ++i) linha += " " + args[i];
+			if (!interpretaTrabalho(linha, trabalho, erro)) {
+				cerr << erro << endl;
+				return -1;
+			}
+			if (!parametrosValidos(trabalho.r, trabalho.t, trabalho.m, trabalho.universo)) return -1;
+			if (opcoes.count("saida")) trabalho.saida = opcoes["saida"];
+			trabalhos.push_back(trabalho);
+		} else {
+			cerr << "O coordenador precisa de --trabalhos ARQ ou de r t m buscas sobreposicao jogos" << endl;
+			return -1;
+		}
+		size_t bloco = 1, qtd_locais = 0;
+		if (opcoes.count("bloco")) bloco = std::max<size_t>(strtoull(opcoes["bloco"].c_str(), NULL, 10), 1);
+		if (opcoes.count("trabalhadores-locais")) qtd_locais = strtoull(opcoes["trabalhadores-locais"].c_str(), NULL, 10);
+		unsigned porta = strtoul(opcoes["coordenador"].c_str(), NULL, 10);
+		if (porta > 65535 || (porta == 0 && qtd_locais == 0)) {
+			cerr << "Porta invalida: " << opcoes["coordenador"] << " (0 so com --trabalhadores-locais)" << endl;
+			return -1;
+		}
+		return executaCoordenador(porta, trabalhos, bloco, qtd_locais,
+		                          qtd_locais ? comandoTrabalhadorLocal(argv[0], opcoes, qtd_locais) : string(),
+		                          recursos);
+	}
+	if (opcoes.count("trabalhos")) return executaLote(opcoes["trabalhos"], trabalho, recursos);
+	if (opcoes.count("saida")) trabalho.saida = opcoes["saida"];
+	// Checkpoint e retomada so valem para a busca avulsa, que e a que roda por horas
+	if (opcoes.count("checkpoint")) recursos.arquivo_checkpoint = opcoes["checkpoint"];
+	if (opcoes.count("checkpoint-s")) recursos.periodo_checkpoint = strtod(opcoes["checkpoint-s"].c_str(), NULL);
+	recursos.retoma = opcoes.count("retoma") > 0;
+	if (recursos.retoma && recursos.arquivo_checkpoint.empty()) {
+		cerr << "--retoma precisa de --checkpoint ARQ" << endl;
+		return -1;
+	}
+
+	size_t qtdArgs = 6;
+  if (args.size() ==qtdArgs)	trabalho.r = atoi(args[0].c_str());
+  else{
+	  cout << "Digite quantidade de dezenas da loteria: ";
+	  cin >> trabalho.r;
+	}
+  if (args.size() ==qtdArgs)
+  	trabalho.t = atoi(args[1].c_str());
+  else{
+
+	  cout << "digite quantidade de dezenas sorteadas: ";
+	  cin >> trabalho.t;
+	}
+    if (args.size() ==qtdArgs)	trabalho.m = atoi(args[2].c_str());
+	else{
+
+		cout << "digite quantidade de dezenas da  garantia: ";
+		cin >> trabalho.m;
+	}
+	if (args.size() ==qtdArgs)trabalho.buscas = atoi(args[3].c_str());
+	else{
+		cout << "Entre com quantidade de tentativas de buscas: ";
+		cin >> trabalho.buscas;
+	}
+	if (args.size() ==qtdArgs)trabalho.sobreposicao = atoi(args[4].c_str());
+	else{
+		cout << "permitir sobreposicao, digite 1 para sim 0 para nao: ";
+		cin >> trabalho.sobreposicao;
+	}
+	if (args.size() ==qtdArgs)trabalho.jogos = atoi(args[5].c_str());
+	else{
+		cout << "Digite a quantidades de jogos: ";
+		cin >> trabalho.jogos;
+	}
+	if (!parametrosValidos(trabalho.r, trabalho.t, trabalho.m, trabalho.universo)) return -1;
+	defineTrabalho(trabalho);
+
+	if (!previsaoCabe(recursos)) return -1;
+	BibliotecaRodas::Roda roda;
+	buscaRoda(recursos, roda);
+	if (roda.empty()) {
+		cerr << "Busca interrompida antes da primeira roda completa; nada foi gravado." << endl;
+		return -1;
+	}
+
+	//permitirSobreposicao=0;
+	std::vector<std::vector<int>> apostasTotais;
+  cout.flush();
+
+	INSTR_FASE(fase_filtros, "filtros");
+	montaJogos(roda, trabalho, novaSemente(), recursos.resultados, true, apostasTotais);
+	INSTR_FASE_ENCERRA(fase_filtros);
 
 	cout<<"\n total Jogos "<<apostasTotais.size();
-	saveApostasTotaisToFile(apostasTotais,qtd_dezenas_jogo,qtd_dezenas_sorteio);
+	INSTR_FASE(fase_gravacao, "gravacao");
+	if (trabalho.saida.empty())
+		saveApostasTotaisToFile(apostasTotais,qtd_dezenas_jogo,qtd_dezenas_sorteio,qtd_dez_garante_acertos);
+	else if (gravaApostasArquivo(apostasTotais, trabalho.saida))
+		cout << "Dados gravados com sucesso no arquivo: " << trabalho.saida << endl;
+	INSTR_FASE_ENCERRA(fase_gravacao);
+	memImprimeResumo(cout);
 //   stringstream sstr_wheel_savename;
 
 //   sstr_wheel_savename << "wheel-" << qtd_dezenas_jogo << "-" << qtd_dezenas_sorteio << "-"
@@ -998,4 +3371,4 @@ int main(int argc, char *argv[])
 
   return 0;
 }
-
+#endif
@@ -35,34 +35,48 @@
 #define WHEELGEN_H
 
 #include <vector>
+#include <string>
 #include <sys/types.h>
 #include <stdint.h>
+#include <atomic>
+#include <boost/dynamic_bitset.hpp>
+// Os nos sao parametrizados pela largura dos indices (e do contador de
+// cobertura, que nunca passa da quantidade de tickets): 32 bits enquanto o
+// problema couber (indices32Bits), para nos mais densos na cache, e 64 bits
+// para instancias enormes.
 //a variavel unsigned is_covered e demais seguidos de dois ponto o numero apos ele é a quantidade maxima de bits aceitavel pela variavel
-struct TicketNode
+template <class Indice>
+struct TicketNodeT
 {
-  unsigned is_covered         :1;
-  unsigned remaining_coverage :31;
-  std::vector<uint32_t> match_indexes;
-  TicketNode(){}
-  TicketNode(bool b_is_covered, int n_remaining_coverage,
-             const std::vector<uint32_t>& v_match_indexes)
+  Indice is_covered         :1;
+  Indice remaining_coverage :sizeof(Indice) * 8 - 1;
+  std::vector<Indice> match_indexes;
+  TicketNodeT(){}
+  TicketNodeT(bool b_is_covered, uint64_t n_remaining_coverage,
+             const std::vector<Indice>& v_match_indexes)
 	: is_covered(b_is_covered),remaining_coverage(n_remaining_coverage), match_indexes(v_match_indexes){}
 };
 
-struct MatchNode
+template <class Indice>
+struct MatchNodeT
 {
-  	std::vector<uint64_t> ticket_indexes;
-	MatchNode(){}
-	MatchNode(const std::vector<uint64_t>& v_match_indexes)
+  	std::vector<Indice> ticket_indexes;
+	MatchNodeT(){}
+	MatchNodeT(const std::vector<Indice>& v_match_indexes)
 	:ticket_indexes(v_match_indexes){}
 };
 
+typedef TicketNodeT<uint32_t> TicketNode;
+typedef MatchNodeT<uint32_t> MatchNode;
+typedef TicketNodeT<uint64_t> TicketNode64;
+typedef MatchNodeT<uint64_t> MatchNode64;
+
 struct DFSStackEntry
 {
-  unsigned is_ticket    :1;
-  unsigned is_level_two :1;
-  unsigned is_visited   :1;
-  unsigned index        :64;
+  uint64_t is_ticket    :1;
+  uint64_t is_level_two :1;
+  uint64_t is_visited   :1;
+  uint64_t index        :61;
 
   DFSStackEntry(uint64_t idx, bool b_is_ticket, bool b_is_level_2)
     : is_ticket(b_is_ticket ? 1 : 0),
@@ -75,5 +89,93 @@ struct DFSStackEntry
   #endif
   ;
 
+// Forma de escolher os tickets em generateWheel
+enum ModoGuloso
+{
+  GULOSO_PADRAO,      ///< argmax dos potenciais mantidos por updatePotentials
+  GULOSO_PREGUICOSO,  ///< ganho exato reavaliado so no topo de um heap (CELF)
+  GULOSO_LOTE         ///< varios empatados que nao interferem por rodada
+};
+
+// Motor do guloso padrao (--motor)
+enum MotorGuloso
+{
+  MOTOR_AUTOMATICO,   ///< trocas para m = t - 1, senao MotorFixo se instanciado, senao o generico
+  MOTOR_FIXO,         ///< MotorFixo quando (r, t, m) foi instanciado, senao o generico
+  MOTOR_GENERICO,     ///< nos de generateNodes com updatePotentials
+  MOTOR_IMPLICITO,    ///< sem grafo, vizinhos gerados a partir do rank (MotorImplicito)
+  MOTOR_TROCA         ///< sem grafo, trocas de uma dezena (MotorTroca, so para m = t - 1)
+};
+
+// Parametros do problema, definidos em wheelgen.cpp
+extern size_t qtdBusca, permitirSobreposicao, qtd_dezenas_jogo, menorAposta;
+extern size_t qtd_dez_garante_acertos, qtd_dezenas_sorteio, qtd_jogos;
+extern size_t qtdThreads, limiarParalelo;
+extern ModoGuloso modoGuloso;
+extern size_t tamanhoLote;
+extern MotorGuloso motorGuloso;
+extern std::string dirGrafoDisco;
+extern uint64_t bytesCacheGrafoDisco, bytesShardGrafoDisco;
+extern size_t profundidadeSimetria;
+extern bool manterGrafo;
+// Menor roda conhecida por outro processo (modo trabalhador); as tentativas
+// que passam dela sao abandonadas como as que passam de menorAposta
+extern std::atomic<size_t> menorApostaCompartilhada;
+
+// Sementes dos geradores aleatorios: com semente 0 (o padrao) vem do relogio.
+// A semente e a quantidade ja usada sao o estado inteiro (checkpoint)
+void defineSemente(uint64_t semente, uint64_t usadas = 0);
+uint64_t novaSemente();
+uint64_t sementeDefinida();
+uint64_t qtdSementesUsadas();
+
+// Indices de 32 bits bastam para (r, t, m)? Senao o gerador usa os de 64
+bool indices32Bits(size_t range, size_t ticket_size, size_t match_size);
+
+// O guloso vai rodar sem montar o grafo de nos (nem a lista de garantias)?
+bool motorSemGrafo();
+
+// Descarta os nos guardados entre as tentativas (as copias _cp)
+void limpaCopiasNos();
+
+// Ha nos (ou um grafo em disco) guardados de uma execucao anterior?
+bool grafoGuardado();
+
+// Motor generico, instanciado em wheelgen.cpp para uint32_t e uint64_t
+template <class Indice>
+void generateNodes(const std::vector<boost::dynamic_bitset<> >& all_tickets,
+                   std::vector<boost::dynamic_bitset<> >& todas_garantias,
+                   std::vector<TicketNodeT<Indice> >& ticket_nodes,
+                   std::vector<MatchNodeT<Indice> >& garantias_nodes);
+template <class Indice>
+void updatePotentials(std::vector<TicketNodeT<Indice> >& ticket_nodes,
+                      std::vector<MatchNodeT<Indice> >& garantias_nodes,
+                      uint64_t start_ticket_idx);
+template <class Indice>
+void updatePotentialsDFS(std::vector<TicketNodeT<Indice> >& ticket_nodes,
+                         std::vector<MatchNodeT<Indice> >& garantias_nodes,
+                         uint64_t start_ticket_idx);
+template <class Indice>
+uint64_t findBestCoverageTickets(const std::vector<TicketNodeT<Indice> >& ticket_nodes,
+                                 std::vector<uint64_t>& best_coverage_ticket_idxs);
+// Os tickets saem de UniversoTickets::obtem(), quando o motor precisa deles
+void generateWheel(std::vector<boost::dynamic_bitset<> >& todas_garantias,
+                   std::vector<uint64_t>& wheel_ticket_idxs);
+
+// Filtros e gravacao dos jogos gerados
+bool gravaApostasArquivo(const std::vector<std::vector<int> >& apostasTotais,
+                         const std::string& filename);
+void saveApostasTotaisToFile(const std::vector<std::vector<int> >& apostasTotais,
+                             int qtd_dezenas_jogo, int qtd_dezenas_sorteio, int qtd_dez_garante_acertos);
+void eliminaNumPosicao(std::vector<std::vector<int> >& jogosGerados);
+void eliminaNumSequencia(int numSeq, std::vector<std::vector<int> >& possibilidades);
+void eliminaMaiorGap(int numGap, std::vector<std::vector<int> >& jogosGerados);
+std::vector<std::vector<int> > obter_resultados(const std::string& nomeArquivo);
+void remove15E14Num(const std::vector<std::vector<int> >& resultSorteio,
+                    std::vector<std::vector<int> >& jogosGerados);
+bool filtrosValidos(const std::string& filtros);
+void aplicaFiltros(const std::string& filtros, const std::vector<std::vector<int> >& resultSorteio,
+                   std::vector<std::vector<int> >& jogosGerados);
+
 #endif
 